@@ -0,0 +1,73 @@
+// Benchmark do carregamento de programas texto: parseInstructions + decodificação
+// (caminho antigo) contra parseProgram (parser em uma passada sobre o texto mapeado).
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include "loader.hpp"
+#include "parser.hpp"
+#include "program.hpp"
+
+// Gera um programa no estilo da saída do compilador (procedimentos recursivos, CRLF e indentação)
+static std::string generateProgram(int procedures) {
+    std::string text = "    START           \r\n    ALLOC   0,4   \r\n    JMP     L0       \r\n";
+    for (int i = 1; i <= procedures; i++) {
+        std::string l = "L" + std::to_string(i);
+        text += l + "   NULL            \r\n";
+        text += "    ALLOC   4,2   \r\n    LDV     0       \r\n    LDC     " + std::to_string(i) + "      \r\n";
+        text += "    CMA             \r\n    JMPF    E" + std::to_string(i) + "       \r\n";
+        text += "    LDV     0       \r\n    LDC     1       \r\n    SUB             \r\n    STR     0       \r\n";
+        text += "    CALL    " + l + "       \r\n    LDV     1       \r\n    LDV     4       \r\n    MULT            \r\n";
+        text += "    STR     1       \r\n";
+        text += "E" + std::to_string(i) + "   NULL            \r\n";
+        text += "    DALLOC  4,2   \r\n    RETURN          \r\n";
+    }
+    text += "L0   NULL            \r\n    RD              \r\n    STR     0       \r\n    CALL    L1       \r\n";
+    text += "    LDV     1       \r\n    PRN             \r\n    DALLOC  0,4   \r\n    HLT             \r\n";
+    return text;
+}
+
+template <typename Fn>
+static double bestSeconds(int repetitions, Fn fn) {
+    double best = 1e30;
+    for (int i = 0; i < repetitions; i++) {
+        auto start = std::chrono::steady_clock::now();
+        fn();
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        best = std::min(best, elapsed.count());
+    }
+    return best;
+}
+
+int main(int argc, char* argv[]) {
+    const int procedures = argc > 1 ? std::stoi(argv[1]) : 50000;
+    const int repetitions = 5;
+
+    const std::string text = generateProgram(procedures);
+    size_t lines = 0;
+    for (char c : text) lines += c == '\n';
+
+    const std::string path = "bench/parser_bench_input.txt";
+    std::ofstream(path, std::ios::binary) << text;
+
+    double before = bestSeconds(repetitions, [&] {
+        Program program(parseInstructions(text));
+        if (program.size() != lines) std::abort();
+    });
+    double after = bestSeconds(repetitions, [&] {
+        ParsedProgram parsed = parseProgram(text);
+        if (parsed.code.size() != lines + 1) std::abort();
+    });
+    double afterFile = bestSeconds(repetitions, [&] {
+        std::shared_ptr<const Program> program = loadProgram(path);
+        if (program->size() != lines) std::abort();
+    });
+    std::remove(path.c_str());
+
+    std::printf("linhas: %zu (%.1f MB)\n", lines, text.size() / 1e6);
+    std::printf("parseInstructions + decodificação: %8.3f ms  %6.2f M linhas/s\n", before * 1e3, lines / before / 1e6);
+    std::printf("parseProgram:                      %8.3f ms  %6.2f M linhas/s\n", after * 1e3, lines / after / 1e6);
+    std::printf("loadProgram (mmap + parseProgram): %8.3f ms  %6.2f M linhas/s\n", afterFile * 1e3, lines / afterFile / 1e6);
+    return 0;
+}
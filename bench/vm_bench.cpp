@@ -0,0 +1,385 @@
+// Benchmark da execução: cargas geradas (recursão, laços aritméticos, quadros grandes de
+// ALLOC/DALLOC, E/S e programas grandes) em cada motor disponível. Resultado em JSON, para
+// comparar builds: instruções/s, ns/instrução, tempo de carga e pico de memória (RSS).
+//
+// Uso: vm_bench [--repeat N] [--scale F] [--workload nome] [--engine nome] [--out arquivo]
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "loader.hpp"
+#include "program.hpp"
+#include "vm.hpp"
+
+struct Workload {
+    const char* name;
+    const char* description;
+    std::string text;       // programa
+    std::vector<int> input; // valores lidos por RD
+};
+
+struct EngineInfo {
+    const char* name;
+    Engine engine;
+};
+
+static const EngineInfo ENGINES[] = {
+    {"table", Engine::Table},
+#ifdef VM_HAS_THREADED_DISPATCH
+    {"threaded", Engine::Threaded},
+#endif
+#ifdef VM_HAS_JIT
+    {"jit", Engine::Jit},
+#endif
+};
+
+static constexpr size_t BENCH_STACK_SIZE = 1 << 20;
+
+// Fibonacci recursivo, com a convenção de chamada de test_instructions1.txt:
+// argumento em 0, resultado em 1, locais salvos com ALLOC/DALLOC
+static std::string fibonacci() {
+    return "START\n"
+           "ALLOC 0,4\n"
+           "JMP L1\n"
+           "L2 NULL\n"
+           "ALLOC 2,2\n"
+           "LDV 0\nSTR 2\n"
+           "LDV 2\nLDC 2\nCME\nJMPF L3\n"
+           "LDV 2\nSTR 1\nJMP L4\n"
+           "L3 NULL\n"
+           "LDV 2\nLDC 1\nSUB\nSTR 0\nCALL L2\n"
+           "LDV 1\nSTR 3\n"
+           "LDV 2\nLDC 2\nSUB\nSTR 0\nCALL L2\n"
+           "LDV 3\nLDV 1\nADD\nSTR 1\n"
+           "L4 NULL\n"
+           "DALLOC 2,2\n"
+           "RETURN\n"
+           "L1 NULL\n"
+           "RD\nSTR 0\nCALL L2\nLDV 1\nPRN\n"
+           "DALLOC 0,4\n"
+           "HLT\n";
+}
+
+// O fatorial recursivo de test_instructions1.txt, chamado repetidas vezes (contador em 3)
+static std::string factorial() {
+    return "START\n"
+           "ALLOC 0,4\n"
+           "JMP L1\n"
+           "L2 NULL\n"
+           "ALLOC 2,1\n"
+           "LDV 0\nSTR 2\n"
+           "LDV 0\nLDC 1\nSUB\nSTR 0\n"
+           "LDV 2\nLDC 1\nCMA\nJMPF L3\n"
+           "CALL L2\nJMP L4\n"
+           "L3 NULL\n"
+           "LDC 1\nSTR 1\n"
+           "L4 NULL\n"
+           "LDV 1\nLDV 2\nMULT\nSTR 1\n"
+           "DALLOC 2,1\n"
+           "RETURN\n"
+           "L1 NULL\n"
+           "RD\nSTR 3\n"
+           "L5 NULL\n"
+           "LDV 3\nLDC 0\nCMA\nJMPF L6\n"
+           "LDC 12\nSTR 0\nCALL L2\n"
+           "LDV 3\nLDC 1\nSUB\nSTR 3\n"
+           "JMP L5\n"
+           "L6 NULL\n"
+           "LDV 1\nPRN\n"
+           "DALLOC 0,4\n"
+           "HLT\n";
+}
+
+// Laço aritmético sem chamadas: todas as operações binárias e unárias
+static std::string arithmetic() {
+    return "START\n"
+           "ALLOC 0,3\n"
+           "RD\nSTR 0\n"
+           "LDC 0\nSTR 1\n"
+           "L1 NULL\n"
+           "LDV 0\nLDC 0\nCMA\nJMPF L2\n"
+           "LDV 1\nLDV 0\nLDC 3\nMULT\nADD\nLDV 0\nLDC 7\nDIVI\nSUB\nSTR 1\n"
+           "LDV 1\nLDC 1000000\nCMAQ\nJMPF L3\n"
+           "LDV 1\nINV\nLDC 2\nDIVI\nSTR 1\n"
+           "L3 NULL\n"
+           "LDV 0\nLDC 1\nCEQ\nLDV 0\nLDC 2\nCDIF\nOR\nNEG\nSTR 2\n"
+           "LDV 0\nLDC 1\nSUB\nSTR 0\n"
+           "JMP L1\n"
+           "L2 NULL\n"
+           "LDV 1\nPRN\n"
+           "DALLOC 0,3\n"
+           "HLT\n";
+}
+
+// Recursão profunda com quadros grandes: cada chamada salva FRAME posições com ALLOC
+// e as restaura com DALLOC; a descida é repetida até o contador em 1 zerar
+static std::string frames() {
+    const int FRAME = 64;
+    const int DEPTH = 1000;
+    const std::string frame = "4," + std::to_string(FRAME);
+    return "START\n"
+           "ALLOC 0," + std::to_string(4 + FRAME) + "\n"
+           "JMP L1\n"
+           "L2 NULL\n"
+           "ALLOC " + frame + "\n"
+           "LDV 0\nSTR 4\n"
+           "LDV 0\nLDC 0\nCMA\nJMPF L3\n"
+           "LDV 0\nLDC 1\nSUB\nSTR 0\nCALL L2\n"
+           "L3 NULL\n"
+           "LDV 2\nLDV 4\nADD\nSTR 2\n"
+           "DALLOC " + frame + "\n"
+           "RETURN\n"
+           "L1 NULL\n"
+           "RD\nSTR 1\n"
+           "L4 NULL\n"
+           "LDV 1\nLDC 0\nCMA\nJMPF L5\n"
+           "LDC " + std::to_string(DEPTH) + "\nSTR 0\nCALL L2\n"
+           "LDV 1\nLDC 1\nSUB\nSTR 1\n"
+           "JMP L4\n"
+           "L5 NULL\n"
+           "LDV 2\nPRN\n"
+           "DALLOC 0," + std::to_string(4 + FRAME) + "\n"
+           "HLT\n";
+}
+
+// Fluxo de E/S: lê a quantidade e depois cada valor, escrevendo o dobro
+static std::string io() {
+    return "START\n"
+           "ALLOC 0,2\n"
+           "RD\nSTR 0\n"
+           "L1 NULL\n"
+           "LDV 0\nLDC 0\nCMA\nJMPF L2\n"
+           "RD\nSTR 1\nLDV 1\nLDC 2\nMULT\nPRN\n"
+           "LDV 0\nLDC 1\nSUB\nSTR 0\n"
+           "JMP L1\n"
+           "L2 NULL\n"
+           "DALLOC 0,2\n"
+           "HLT\n";
+}
+
+// Programa grande no estilo da saída do compilador (CRLF e indentação): muitos
+// procedimentos, cada um chamado uma vez pelo programa principal
+static std::string large(int procedures) {
+    std::string text = "    START           \r\n    ALLOC   0,4   \r\n    JMP     L0       \r\n";
+    for (int i = 1; i <= procedures; i++) {
+        std::string n = std::to_string(i);
+        text += "L" + n + "   NULL            \r\n";
+        text += "    ALLOC   2,2   \r\n    LDV     0       \r\n    LDC     " + n + "      \r\n";
+        text += "    ADD             \r\n    STR     2       \r\n    LDV     2       \r\n    LDC     3       \r\n";
+        text += "    MULT            \r\n    STR     3       \r\n    LDV     3       \r\n    LDC     1000    \r\n";
+        text += "    CMA             \r\n    JMPF    E" + n + "       \r\n    LDC     0       \r\n    STR     3       \r\n";
+        text += "E" + n + "   NULL            \r\n";
+        text += "    LDV     3       \r\n    STR     0       \r\n    DALLOC  2,2   \r\n    RETURN          \r\n";
+    }
+    text += "L0   NULL            \r\n    RD              \r\n    STR     0       \r\n";
+    for (int i = 1; i <= procedures; i++) text += "    CALL    L" + std::to_string(i) + "       \r\n";
+    text += "    LDV     0       \r\n    PRN             \r\n    DALLOC  0,4   \r\n    HLT             \r\n";
+    return text;
+}
+
+static const char* const WORKLOADS[] = {"fibonacci", "factorial", "arithmetic", "frames", "io", "large"};
+
+// Gerada só no processo que a executa, para não pesar no RSS das outras
+static Workload makeWorkload(const std::string& name, double scale) {
+    auto scaled = [scale](double n) { return std::max(1, static_cast<int>(n * scale)); };
+    if (name == "fibonacci") return {"fibonacci", "fibonacci recursivo", fibonacci(), {std::min(scaled(27), 40)}};
+    if (name == "factorial") return {"factorial", "fatorial recursivo repetido", factorial(), {scaled(200000)}};
+    if (name == "arithmetic") return {"arithmetic", "laço aritmético", arithmetic(), {scaled(1000000)}};
+    if (name == "frames") return {"frames", "recursão profunda com ALLOC/DALLOC grandes", frames(), {scaled(300)}};
+    if (name == "io") {
+        std::vector<int> values(scaled(2000000) + 1);
+        values[0] = static_cast<int>(values.size() - 1);
+        for (size_t i = 1; i < values.size(); i++) values[i] = static_cast<int>(i % 1000);
+        return {"io", "fluxo de RD/PRN", io(), std::move(values)};
+    }
+    return {"large", "programa grande (carga)", large(scaled(50000)), {1}};
+}
+
+template <typename Fn>
+static std::vector<double> timings(int repetitions, Fn fn) {
+    fn(); // aquecimento: páginas, caches e compilação do JIT
+    std::vector<double> seconds;
+    for (int i = 0; i < repetitions; i++) {
+        auto start = std::chrono::steady_clock::now();
+        fn();
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        seconds.push_back(elapsed.count());
+    }
+    std::sort(seconds.begin(), seconds.end());
+    return seconds;
+}
+
+static double median(const std::vector<double>& sorted) {
+    size_t n = sorted.size();
+    return n % 2 ? sorted[n / 2] : (sorted[n / 2 - 1] + sorted[n / 2]) / 2;
+}
+
+static long peakRssKb() {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+}
+
+// A saída só entra num checksum, para que todos os motores sejam comparados
+static void consume(const int* values, size_t count, void* user) {
+    auto* sum = static_cast<long long*>(user);
+    for (size_t i = 0; i < count; i++) *sum = *sum * 31 + values[i];
+}
+
+// Mede uma carga e devolve o objeto JSON correspondente
+static std::string runWorkload(const std::string& name, double scale, const std::vector<EngineInfo>& engines,
+                               int repetitions) {
+    const Workload w = makeWorkload(name, scale);
+    const std::string path = std::string("bench/vm_bench_") + w.name + ".txt";
+    std::ofstream(path, std::ios::binary) << w.text;
+    size_t lines = std::count(w.text.begin(), w.text.end(), '\n');
+
+    std::shared_ptr<const Program> program;
+    std::vector<double> load = timings(repetitions, [&] { program = loadProgram(path); });
+    std::remove(path.c_str());
+
+    std::ostringstream json;
+    json << "{\"name\": \"" << w.name << "\", \"description\": \"" << w.description << "\", \"lines\": " << lines
+         << ", \"bytes\": " << w.text.size() << ", \"load_ms\": " << load.front() * 1e3
+         << ", \"load_median_ms\": " << median(load) * 1e3 << ", \"engines\": [";
+
+    VirtualMachine vm(BENCH_STACK_SIZE);
+    std::vector<int> output(4096);
+    for (size_t e = 0; e < engines.size(); e++) {
+        uint64_t instructions = 0;
+        long long checksum = 0;
+        std::vector<double> run = timings(repetitions, [&] {
+            vm.stack.clear();
+            vm.startVM(program);
+            checksum = 0;
+            IOBuffers io;
+            io.input = w.input.data();
+            io.inputSize = w.input.size();
+            io.output = output.data();
+            io.outputCapacity = output.size();
+            io.flush = consume;
+            io.user = &checksum;
+            if (vm.execute(io, engines[e].engine) != ExecStatus::Halted) {
+                std::cerr << w.name << ": a execução não terminou\n";
+                std::exit(1);
+            }
+            consume(io.output, io.outputSize, &checksum);
+            instructions = vm.dispatches;
+        });
+
+        double best = run.front();
+        json << (e ? ", " : "") << "{\"engine\": \"" << engines[e].name << "\", \"instructions\": " << instructions
+             << ", \"seconds\": " << best << ", \"median_seconds\": " << median(run)
+             << ", \"instructions_per_second\": " << instructions / best
+             << ", \"ns_per_instruction\": " << best * 1e9 / instructions << ", \"checksum\": " << checksum << "}";
+        std::fprintf(stderr, "%-12s %-9s %12llu instr  %9.3f ms  %7.2f M instr/s  %6.2f ns/instr\n", w.name,
+                     engines[e].name, static_cast<unsigned long long>(instructions), best * 1e3,
+                     instructions / best / 1e6, best * 1e9 / instructions);
+    }
+    json << "], \"peak_rss_kb\": " << peakRssKb() << "}";
+    std::fprintf(stderr, "%-12s carga %.3f ms (%zu linhas), pico de RSS %ld KB\n", w.name, load.front() * 1e3, lines,
+                 peakRssKb());
+    return json.str();
+}
+
+// Cada carga roda num processo filho, para que o pico de RSS seja só dela
+static std::string runIsolated(const std::string& name, double scale, const std::vector<EngineInfo>& engines,
+                               int repetitions) {
+    int fds[2];
+    if (pipe(fds) != 0) return runWorkload(name, scale, engines, repetitions);
+    std::fflush(nullptr);
+    pid_t pid = fork();
+    if (pid < 0) {
+        close(fds[0]);
+        close(fds[1]);
+        return runWorkload(name, scale, engines, repetitions);
+    }
+    if (pid == 0) {
+        close(fds[0]);
+        std::string json = runWorkload(name, scale, engines, repetitions);
+        for (size_t done = 0; done < json.size();) {
+            ssize_t n = write(fds[1], json.data() + done, json.size() - done);
+            if (n <= 0) _exit(1);
+            done += n;
+        }
+        _exit(0);
+    }
+    close(fds[1]);
+    std::string json;
+    char buffer[4096];
+    ssize_t n;
+    while ((n = read(fds[0], buffer, sizeof buffer)) > 0) json.append(buffer, n);
+    close(fds[0]);
+    int status = 0;
+    waitpid(pid, &status, 0);
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        std::cerr << name << ": o benchmark falhou\n";
+        std::exit(1);
+    }
+    return json;
+}
+
+int main(int argc, char* argv[]) {
+    int repetitions = 5;
+    double scale = 1.0;
+    std::string onlyWorkload, onlyEngine, outPath;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (i + 1 >= argc) {
+            std::cerr << "Uso: " << argv[0]
+                      << " [--repeat N] [--scale F] [--workload nome] [--engine nome] [--out arquivo]\n";
+            return 1;
+        }
+        if (arg == "--repeat") repetitions = std::max(1, std::stoi(argv[++i]));
+        else if (arg == "--scale") scale = std::stod(argv[++i]);
+        else if (arg == "--workload") onlyWorkload = argv[++i];
+        else if (arg == "--engine") onlyEngine = argv[++i];
+        else if (arg == "--out") outPath = argv[++i];
+        else {
+            std::cerr << "Opção desconhecida: " << arg << "\n";
+            return 1;
+        }
+    }
+
+    std::vector<EngineInfo> engines;
+    for (const EngineInfo& e : ENGINES) {
+        if (onlyEngine.empty() || onlyEngine == e.name) engines.push_back(e);
+    }
+    if (engines.empty()) {
+        std::cerr << "Motor desconhecido: " << onlyEngine << "\n";
+        return 1;
+    }
+
+    std::ostringstream json;
+    json << "{\"repeat\": " << repetitions << ", \"scale\": " << scale << ", \"workloads\": [";
+    bool first = true;
+    for (const char* name : WORKLOADS) {
+        if (!onlyWorkload.empty() && onlyWorkload != name) continue;
+        json << (first ? "\n  " : ",\n  ") << runIsolated(name, scale, engines, repetitions);
+        first = false;
+    }
+    if (first) {
+        std::cerr << "Carga desconhecida: " << onlyWorkload << "\n";
+        return 1;
+    }
+    json << "\n]}\n";
+
+    if (outPath.empty()) {
+        std::cout << json.str();
+    } else {
+        std::ofstream out(outPath);
+        if (!out) {
+            std::cerr << "Erro ao criar o arquivo " << outPath << "\n";
+            return 1;
+        }
+        out << json.str();
+    }
+    return 0;
+}
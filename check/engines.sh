@@ -0,0 +1,31 @@
+#!/bin/sh
+# Compara os motores: para cada programa e nível de otimização, a saída e o --stats
+# (superinstruções, verificação da pilha e número de despachos) precisam ser iguais em
+# table, threaded e jit. Uso: check/engines.sh [programa...] (padrão: check/*.txt e
+# test_instructions1.txt), a partir da raiz do repositório, depois do make.
+VM=${VM:-./vm}
+INPUT=${INPUT:-5}
+[ $# -gt 0 ] || set -- check/*.txt test_instructions1.txt
+
+failed=0
+for program in "$@"; do
+    for level in 0 1 2; do
+        reference=""
+        for engine in table threaded jit; do
+            # motores ausentes neste build são ignorados
+            result=$(echo "$INPUT" | "$VM" -O$level --engine $engine --stats "$program" 2>&1 | grep -v '^otimizador')
+            case "$result" in *indispon*) continue ;; esac
+            if [ -z "$reference" ]; then
+                reference=$result
+            elif [ "$result" != "$reference" ]; then
+                echo "DIFERENTE: $program -O$level --engine $engine"
+                echo "$reference" | sed 's/^/  table: /'
+                echo "$result" | sed "s/^/  $engine: /"
+                failed=1
+            fi
+        done
+    done
+done
+
+[ $failed -eq 0 ] && echo "motores iguais em $# programa(s), -O0 a -O2"
+exit $failed
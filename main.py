@@ -47,11 +47,29 @@ def parse_instructions(file_content: str) -> List[Instruction]:
 ffi = FFI()
 
 ffi.cdef("""
-    void initVM(char* file_path);
-    void executeVM(int(*readFn)(), void(*writeFn)(int));
+    typedef struct vm_state {
+        int ip;
+        int sp;
+        int start_sp;
+        uint64_t instructions;
+        const int* stack;
+        size_t stack_size;
+        size_t dirty_begin;
+        size_t dirty_end;
+    } vm_state;
+
+    int initVM(char* file_path);
+    int executeVM(int(*readFn)(), void(*writeFn)(int));
     int getVMSp();
     int getVMIp();
     int getVMStack(int sp);
+    int setVMEngine(int engine);
+    const int* getVMStackView(int* length);
+    void getVMState(vm_state* state);
+    int executeVMBuffered(const int* input, int inputSize, int* inputUsed, int* output, int outputCapacity, int* outputSize);
+    int runVM(const int* input, int inputSize, int* inputUsed, int* output, int outputCapacity, int* outputSize,
+              unsigned long long maxInstructions, unsigned long long timeoutUs);
+    const char* getVMError();
 """)
 
 if platform == "linux" or platform == "linux2":
@@ -60,8 +78,10 @@ elif platform == "win32":
     lib = ffi.dlopen("vm.dll")
 
 
+# init_vm e execute_vm lançam RuntimeError com a mensagem da VM num erro
 def init_vm(file_path):
-    lib.initVM(file_path.encode('utf-8'))
+    if lib.initVM(file_path.encode('utf-8')) != 0:
+        raise RuntimeError(get_vm_error())
 
 def execute_vm(read_fn, write_fn):
     @ffi.callback("int()")
@@ -72,7 +92,37 @@ def execute_vm(read_fn, write_fn):
     def write_cb(value):
         write_fn(value)
 
-    lib.executeVM(read_cb, write_cb)
+    if lib.executeVM(read_cb, write_cb) != 0:
+        raise RuntimeError(get_vm_error())
+
+# Executa com E/S em buffers: só volta ao Python quando a entrada acaba (2), a saída
+# enche (3), o programa termina (0) ou há um erro de execução (1, ver get_vm_error).
+# Retorna (status, valores consumidos, saída)
+def execute_vm_buffered(inputs, output_capacity=4096):
+    input_buf = ffi.new("int[]", list(inputs) or [0])
+    output_buf = ffi.new("int[]", output_capacity)
+    used = ffi.new("int*")
+    written = ffi.new("int*")
+    status = lib.executeVMBuffered(input_buf, len(inputs), used, output_buf, output_capacity, written)
+    return status, used[0], list(output_buf[0:written[0]])
+
+# Como execute_vm_buffered, mas para depois de max_instructions instruções ou timeout_us
+# microssegundos (0: sem limite) com status 4; a chamada seguinte continua de onde parou
+def run_vm(inputs, max_instructions=0, timeout_us=0, output_capacity=4096):
+    input_buf = ffi.new("int[]", list(inputs) or [0])
+    output_buf = ffi.new("int[]", output_capacity)
+    used = ffi.new("int*")
+    written = ffi.new("int*")
+    status = lib.runVM(input_buf, len(inputs), used, output_buf, output_capacity, written, max_instructions, timeout_us)
+    return status, used[0], list(output_buf[0:written[0]])
+
+# Mensagem do último erro de execução ("" se não houve)
+def get_vm_error():
+    return ffi.string(lib.getVMError()).decode('utf-8', 'replace')
+
+# 0 = tabela, 1 = threaded, 2 = JIT (x86-64); retorna False se o motor não existe neste build
+def set_vm_engine(engine):
+    return lib.setVMEngine(engine) == 1
 
 def get_vm_sp():
     return lib.getVMSp()
@@ -83,6 +133,13 @@ def get_vm_ip():
 def get_vm_stack(sp):
     return lib.getVMStack(sp)
 
+# Registradores e pilha numa chamada só; state.stack aponta direto para a pilha da VM e
+# [dirty_begin, dirty_end) são as posições alteradas desde a chamada anterior
+def get_vm_state():
+    state = ffi.new("vm_state*")
+    lib.getVMState(state)
+    return state
+
 class Console(tk.Frame):
     def __init__(self, parent=None, **kwargs):
         super().__init__(parent, **kwargs)
@@ -90,28 +147,20 @@ class Console(tk.Frame):
         self.ttytext.pack(fill=tk.BOTH, expand=True)
         self.ttytext.bind("<Return>", self.enter)
         self.line_start = "1.0"
-        self.input_buffer = ""
-        self.input_ready = False
+        self.on_input = None # chamado com cada linha digitada
 
     def enter(self, event):
         user_input = self.ttytext.get(self.line_start, tk.END).strip()
-        self.input_buffer = user_input
-        self.input_ready = True
         # self.ttytext.insert(tk.END, f"\nYou entered: {user_input}\n")
         self.ttytext.insert(tk.END, f"\n")
         self.ttytext.mark_set("insert", tk.END)
         self.ttytext.see(tk.END)
         self.line_start = self.ttytext.index(tk.INSERT)
+        if self.on_input:
+            self.on_input(user_input)
 
         return 'break'
 
-    def get_input(self):
-        while not self.input_ready:
-            self.update_idletasks()
-            self.update()
-        self.input_ready = False
-        return self.input_buffer
-
     def print_output(self, text):
         self.ttytext.insert(tk.END, f"{text}")
         self.ttytext.mark_set("insert", tk.END)
@@ -124,6 +173,7 @@ class VirtualMachineInterface:
         self.root.title("Virtual Machine Interface")
 
         self.instructions = []
+        self.stack_rows = [] # linhas da tabela da pilha, uma por posição exibida
 
         # Import bytecode button
         self.import_button = tk.Button(root, text="Import Bytecode", command=self.import_bytecode)
@@ -188,34 +238,67 @@ class VirtualMachineInterface:
     def update_tables(self):
         self.select_instruction_pointer()
 
-        for i in self.stack_table.get_children():
-            self.stack_table.delete(i)
+        state = get_vm_state()
+        sp = max(state.sp, 0)
 
-        sp = get_vm_sp()
-        for i in range(sp):
-            value = get_vm_stack(i)
-            self.stack_table.insert("", "end", values=(i, value))
+        # só as linhas novas e as posições alteradas são redesenhadas
+        while len(self.stack_rows) > sp:
+            self.stack_table.delete(self.stack_rows.pop())
+        for i in range(state.dirty_begin, min(state.dirty_end, len(self.stack_rows))):
+            self.stack_table.item(self.stack_rows[i], values=(i, state.stack[i]))
+        for i in range(len(self.stack_rows), sp):
+            self.stack_rows.append(self.stack_table.insert("", "end", values=(i, state.stack[i])))
 
-    def read_fn(self):
-        self.update_tables()
-        self.console.print_output("> ")
-        while True:
-            input_value = self.console.get_input()
-            try:
-                return int(input_value)
-            except ValueError:
-                self.console.print_output("Invalid input, please enter an integer.")
-
-    def print_fn(self, var):
-        self.console.print_output(f"Output: {var}\n")
-        self.update_tables()
+    # Execução dirigida pelo mainloop do Tk: a VM roda em fatias de RUN_SLICE_US e, parada
+    # num RD sem entrada, volta ao mainloop sem bloquear; a linha digitada no console retoma
+    # a execução. Nenhuma espera ocupada e nenhuma thread por execução.
+    RUN_SLICE_US = 20000
 
     def execute(self):
         if not self.file_path:
             return
-        init_vm(self.file_path)
-        execute_vm(self.read_fn, self.print_fn)
-        self.update_tables()
+        try:
+            init_vm(self.file_path)
+        except RuntimeError as error:
+            self.console.print_output(f"Error: {error}\n")
+            return
+        for row in self.stack_rows:
+            self.stack_table.delete(row)
+        self.stack_rows = []
+        get_vm_state() # a faixa alterada passa a valer a partir daqui
+        self.pending_input = []
+        self.console.on_input = None
+        self.resume()
+
+    def resume(self):
+        status, used, output = run_vm(self.pending_input, timeout_us=self.RUN_SLICE_US)
+        del self.pending_input[:used]
+        for value in output:
+            self.console.print_output(f"Output: {value}\n")
+        if output:
+            self.update_tables()
+
+        if status == 2: # RD sem entrada: espera a próxima linha do console
+            self.update_tables()
+            self.console.print_output("> ")
+            self.console.on_input = self.input_line
+        elif status in (3, 4): # saída cheia ou fim da fatia: continua depois dos eventos pendentes
+            self.root.after(1, self.resume)
+        elif status == 1: # erro de execução: a VM fica parada na instrução que falhou
+            self.console.print_output(f"Error: {get_vm_error()}\n")
+            self.update_tables()
+        else:
+            self.update_tables()
+
+    def input_line(self, line):
+        try:
+            value = int(line)
+        except ValueError:
+            self.console.print_output("Invalid input, please enter an integer.")
+            return
+        self.console.on_input = None
+        self.pending_input.append(value)
+        self.resume()
 
 # Create the main window
 root = tk.Tk()
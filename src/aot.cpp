@@ -0,0 +1,475 @@
+#include "aot.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <stdexcept>
+#include <vector>
+#include "peephole.hpp"
+
+namespace {
+
+// Parte fixa do código gerado, depois das constantes do programa
+const char* const PRELUDE = R"(
+namespace {
+
+struct Machine {
+    int ip = 1;
+    int sp = -1;
+    int stack[STACK_SIZE] = {};
+    int snapshot[STACK_SIZE] = {}; // pilha no último getVMState (para a faixa alterada)
+    bool snapshotValid = false;
+    std::string error; // mensagem do último erro de executeVM (getVMError)
+};
+
+Machine machine;
+
+[[noreturn]] void fail(int ip, int sp, const char* message) {
+    machine.ip = ip;
+    machine.sp = sp;
+    throw std::runtime_error(message);
+}
+
+void debugState(int ip, int sp, const char* instruction) {
+    std::cout << "=== Estado da Máquina Virtual ===\n";
+    std::cout << "Instruction Pointer: " << ip << "\n";
+    std::cout << "Stack Pointer: " << sp << "\n";
+    std::cout << "Stack Memory: ";
+    for (int i = sp; i >= 0; i--) {
+        std::cout << machine.stack[i] << " ";
+    }
+    std::cout << "\n" << instruction;
+}
+
+inline int wrap(int64_t value) {
+    return (int)(uint32_t)value;
+}
+
+)";
+
+const char* const EXPORTS = R"(
+} // namespace
+
+typedef struct vm_state {
+    int ip;
+    int sp;
+    int start_sp;
+    uint64_t instructions;
+    const int* stack;
+    size_t stack_size;
+    size_t dirty_begin;
+    size_t dirty_end;
+} vm_state;
+
+extern "C" {
+
+int initVM(char*) {
+    machine.ip = 1;
+    machine.sp = -1;
+    std::memset(machine.stack, 0, sizeof(machine.stack));
+    machine.error.clear();
+    return 0;
+}
+
+// 0, ou 1 num erro de execução (mensagem em getVMError), como em vm.so
+int executeVM(int (*readFn)(), void (*writeFn)(int)) {
+    try {
+        run(readFn, writeFn);
+        machine.error.clear();
+        return 0;
+    } catch (const std::exception& ex) {
+        machine.error = ex.what();
+        return 1;
+    }
+}
+
+const char* getVMError() {
+    return machine.error.c_str();
+}
+
+int getVMSp() {
+    return machine.sp;
+}
+
+int getVMIp() {
+    return machine.ip;
+}
+
+int getVMStack(int index) {
+    return index >= 0 && index < STACK_SIZE ? machine.stack[index] : 0;
+}
+
+const int* getVMStackView(int* length) {
+    *length = STACK_SIZE;
+    return machine.stack;
+}
+
+void getVMState(vm_state* state) {
+    state->ip = machine.ip;
+    state->sp = machine.sp;
+    state->start_sp = -1;
+    state->instructions = 0;
+    state->stack = machine.stack;
+    state->stack_size = STACK_SIZE;
+
+    size_t begin = 0, end = STACK_SIZE;
+    if (machine.snapshotValid) {
+        while (begin < end && machine.stack[begin] == machine.snapshot[begin]) begin++;
+        while (end > begin && machine.stack[end - 1] == machine.snapshot[end - 1]) end--;
+        if (begin == end) begin = end = STACK_SIZE;
+    }
+    std::memcpy(machine.snapshot, machine.stack, sizeof(machine.stack));
+    machine.snapshotValid = true;
+    state->dirty_begin = begin;
+    state->dirty_end = end;
+}
+
+}
+
+#ifndef VM_AOT_LIBRARY
+int main() {
+    try {
+        run([] {
+            int var;
+            std::cout << "> ";
+            std::cin >> var;
+            return var;
+        }, [](int var) {
+            std::cout << var << "\n";
+        });
+    } catch (const std::exception& ex) {
+        std::cerr << "Erro: " << ex.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
+#endif
+)";
+
+// Literal C++ com o texto (bytes fora do ASCII imprimível em octal)
+std::string literal(const std::string& text) {
+    std::string result = "\"";
+    for (unsigned char c : text) {
+        if (c == '"' || c == '\\') {
+            result += '\\';
+            result += (char)c;
+        } else if (c < 0x20 || c >= 0x7f) {
+            char escaped[8];
+            std::snprintf(escaped, sizeof(escaped), "\\%03o", c);
+            result += escaped;
+        } else {
+            result += (char)c;
+        }
+    }
+    return result + "\"";
+}
+
+std::string quote(const std::string& path) {
+    std::string result = "'";
+    for (char c : path) {
+        result += c == '\'' ? std::string("'\\''") : std::string(1, c);
+    }
+    return result + "'";
+}
+
+bool endsWith(const std::string& text, const std::string& suffix) {
+    return text.size() >= suffix.size() && text.compare(text.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+// Traduz as instruções do programa para o corpo de run()
+class Translator {
+public:
+    Translator(std::ostream& out, const Program& program) : out(out), program(program) {}
+
+    void run() {
+        const DecodedInstruction* code = this->program.code();
+        const unsigned size = this->program.size();
+
+        // Pontos de entrada: início, alvos de saltos e de CALL, retornos de CALL e o que vem
+        // depois de HLT (executeVM continua dali). Só eles são alcançáveis pelo switch de
+        // dispatch, o que deixa o compilador otimizar o código entre eles.
+        std::vector<bool> leader(size + 1, false);
+        leader[1] = true;
+        for (unsigned i = 0; i < size; i++) {
+            switch (originalOpcode(code[i].opcode)) {
+                case OpCode::JMP: case OpCode::JMPF:
+                    leader[std::min<unsigned>(code[i].op1, size)] = true;
+                    break;
+                case OpCode::CALL:
+                    leader[std::min<unsigned>(code[i].op1, size)] = true;
+                    leader[i + 1] = true;
+                    break;
+                case OpCode::HLT:
+                    leader[i + 1] = true;
+                    break;
+                default:
+                    break;
+            }
+        }
+
+        this->out << "void run(int (*readFn)(), void (*writeFn)(int)) {\n"
+                  << "    int* const stack = machine.stack;\n"
+                  << "    int sp = machine.sp;\n"
+                  << "    int target = machine.ip;\n"
+                  << "    goto dispatch;\n\n";
+        for (unsigned i = 0; i < size; i++) {
+            this->out << "a" << i << ":\n";
+            this->instruction(i, code[i]);
+        }
+        this->out << "    target = " << size << ";\n"
+                  << "halt:\n"
+                  << "    machine.ip = target;\n"
+                  << "    machine.sp = sp;\n"
+                  << "    return;\n\n";
+
+        // Um RETURN para um endereço que não é ponto de entrada (endereço de retorno
+        // sobrescrito) cai nesta cópia, que segue até o próximo ponto de entrada
+        this->out << "    // cópia para endereços que não são pontos de entrada\n";
+        for (unsigned i = 0; i < size; i++) {
+            if (leader[i]) {
+                continue;
+            }
+            this->out << "s" << i << ":\n";
+            this->instruction(i, code[i]);
+            if (leader[i + 1]) {
+                this->line(this->jump(i + 1));
+            }
+        }
+
+        // entrada e RETURN; endereços fora do programa param a execução, como na VM
+        this->out << "\ndispatch:\n"
+                  << "    switch (target) {\n";
+        for (unsigned i = 0; i < size; i++) {
+            this->out << "        case " << i << ": goto " << (leader[i] ? "a" : "s") << i << ";\n";
+        }
+        this->out << "        default: goto halt;\n"
+                  << "    }\n"
+                  << "}\n";
+    }
+
+private:
+    std::ostream& out;
+    const Program& program;
+
+    void line(const std::string& text) {
+        this->out << "    " << text << "\n";
+    }
+
+    std::string jump(int address) {
+        if ((unsigned)address < this->program.size()) {
+            return "goto a" + std::to_string(address) + ";";
+        }
+        return "{ target = " + std::to_string(address) + "; goto halt; }";
+    }
+
+    // Checagens com o ip que a VM teria no erro (a instrução seguinte)
+    void needPush(unsigned address, int count = 1) {
+        this->line("if (sp > STACK_SIZE - 1 - " + std::to_string(count) + ") fail(" + std::to_string(address + 1) + ", sp, OUT_OF_STACK);");
+    }
+
+    void needTop(unsigned address, int count = 1) {
+        this->line("if (sp < " + std::to_string(count - 1) + ") fail(" + std::to_string(address + 1) + ", sp, OUT_OF_STACK);");
+    }
+
+    void binary(unsigned address, OpCode op, const std::string& result) {
+        this->line(std::string("if (sp <= 0) fail(") + std::to_string(address + 1) + ", sp, \"Valores insuficientes na stack "
+                   + Operations::getName(op) + "\");");
+        this->line("stack[sp - 1] = " + result + ";");
+        this->line("sp--;");
+    }
+
+    void compare(unsigned address, OpCode op, const char* comparison) {
+        this->binary(address, op, std::string("stack[sp - 1] ") + comparison + " stack[sp] ? 1 : 0");
+    }
+
+    void saveState(unsigned address) {
+        this->line("machine.ip = " + std::to_string(address + 1) + ";");
+        this->line("machine.sp = sp;");
+    }
+
+    void instruction(unsigned address, const DecodedInstruction& instr) {
+        const std::string op1 = std::to_string(instr.op1);
+        const std::string op2 = std::to_string(instr.op2);
+        const std::string next = std::to_string(address + 1);
+
+        switch (originalOpcode(instr.opcode)) {
+            case OpCode::NOP:
+            case OpCode::START:
+            case OpCode::END:
+                break;
+            case OpCode::HLT:
+                this->line("target = " + next + ";");
+                this->line("goto halt;");
+                break;
+            case OpCode::DEBUG:
+                this->line("debugState(" + next + ", sp, " + literal(this->program.describeInstruction(address + 1)) + ");");
+                break;
+            case OpCode::LDC:
+                this->needPush(address);
+                this->line("stack[++sp] = " + op1 + ";");
+                break;
+            case OpCode::LDV:
+                this->needPush(address);
+                this->line("stack[sp + 1] = stack[" + op1 + "];");
+                this->line("sp++;");
+                break;
+            case OpCode::ADD:
+                this->binary(address, OpCode::ADD, "wrap((int64_t)stack[sp - 1] + stack[sp])");
+                break;
+            case OpCode::SUB:
+                this->binary(address, OpCode::SUB, "wrap((int64_t)stack[sp - 1] - stack[sp])");
+                break;
+            case OpCode::MULT:
+                this->binary(address, OpCode::MULT, "wrap((int64_t)stack[sp - 1] * stack[sp])");
+                break;
+            case OpCode::DIVI:
+                this->line("if (sp <= 0) fail(" + next + ", sp, \"Valores insuficientes na stack DIVI\");");
+                this->line("if (stack[sp] == 0) fail(" + next + ", sp, \"Divisao por 0\");");
+                this->line("stack[sp - 1] /= stack[sp];");
+                this->line("sp--;");
+                break;
+            case OpCode::INV:
+                this->needTop(address);
+                this->line("stack[sp] = wrap(-(int64_t)stack[sp]);");
+                break;
+            case OpCode::NEG:
+                this->needTop(address);
+                this->line("stack[sp] = wrap(1 - (int64_t)stack[sp]);");
+                break;
+            case OpCode::AND:
+                this->binary(address, OpCode::AND, "stack[sp - 1] == 1 && stack[sp] == 1 ? 1 : 0");
+                break;
+            case OpCode::OR:
+                this->binary(address, OpCode::OR, "stack[sp - 1] == 1 || stack[sp] == 1 ? 1 : 0");
+                break;
+            case OpCode::CME:
+                this->compare(address, OpCode::CME, "<");
+                break;
+            case OpCode::CMA:
+                this->compare(address, OpCode::CMA, ">");
+                break;
+            case OpCode::CEQ:
+                this->compare(address, OpCode::CEQ, "==");
+                break;
+            case OpCode::CDIF:
+                this->compare(address, OpCode::CDIF, "!=");
+                break;
+            case OpCode::CMEQ:
+                this->compare(address, OpCode::CMEQ, "<=");
+                break;
+            case OpCode::CMAQ:
+                this->compare(address, OpCode::CMAQ, ">=");
+                break;
+            case OpCode::JMP:
+                this->line(this->jump(instr.op1));
+                break;
+            case OpCode::JMPF:
+                this->line("if (sp < 0) fail(" + next + ", sp, \"Stack esta vazia para o JMPF\");");
+                this->line("if (stack[sp--] == 0) " + this->jump(instr.op1));
+                break;
+            case OpCode::ALLOC:
+                if (instr.op2 > 0) {
+                    // valor a valor: com origem e destino sobrepostos, os valores copiados são relidos
+                    this->needPush(address, instr.op2);
+                    this->line("for (int k = 0; k < " + op2 + "; k++) stack[sp + 1 + k] = stack[" + op1 + " + k];");
+                    this->line("sp += " + op2 + ";");
+                }
+                break;
+            case OpCode::DALLOC:
+                if (instr.op2 > 0) {
+                    this->needTop(address, instr.op2);
+                    this->line("for (int k = " + op2 + " - 1; k >= 0; k--) stack[" + op1 + " + k] = stack[sp--];");
+                }
+                break;
+            case OpCode::RD:
+                this->saveState(address);
+                this->line("{");
+                this->line("    int value = readFn();");
+                this->line("    if (sp > STACK_SIZE - 2) fail(" + next + ", sp, OUT_OF_STACK);");
+                this->line("    stack[++sp] = value;");
+                this->line("}");
+                break;
+            case OpCode::PRN:
+                this->needTop(address);
+                this->saveState(address);
+                this->line("writeFn(stack[sp]);");
+                this->line("sp--;");
+                break;
+            case OpCode::STR:
+                this->needTop(address);
+                this->line("stack[" + op1 + "] = stack[sp--];");
+                break;
+            case OpCode::CALL:
+                this->needPush(address);
+                this->line("stack[++sp] = " + next + ";");
+                this->line(this->jump(instr.op1));
+                break;
+            case OpCode::RETURN:
+                this->needTop(address);
+                this->line("target = stack[sp--];");
+                this->line("goto dispatch;");
+                break;
+            default:
+                throw std::logic_error(std::string("Instrução sem tradução: ") + Operations::getName(instr.opcode));
+        }
+    }
+};
+
+} // namespace
+
+void writeAotSource(std::ostream& out, const Program& program, size_t stackSize) {
+    // mesmo tamanho e mesmas checagens de VirtualMachine::startVM
+    const size_t positions = VMStack(stackSize).size();
+    if (program.size() == 0 || program.code()[0].opcode != OpCode::START) {
+        throw std::invalid_argument("O programa não começa com START");
+    }
+    if (program.lowestAddress() <= program.highestAddress()
+        && (program.lowestAddress() < 0 || program.highestAddress() >= (int64_t)positions)) {
+        int64_t address = program.lowestAddress() < 0 ? program.lowestAddress() : program.highestAddress();
+        throw std::invalid_argument("O programa acessa o endereço " + std::to_string(address)
+            + ", fora da pilha (" + std::to_string(positions) + " posições)");
+    }
+
+    out << "// Gerado por vm --aot; não editar\n"
+        << "#include <cstdint>\n"
+        << "#include <cstring>\n"
+        << "#include <iostream>\n"
+        << "#include <stdexcept>\n"
+        << "#include <string>\n\n"
+        << "constexpr int STACK_SIZE = " << positions << ";\n"
+        << "constexpr const char* OUT_OF_STACK = "
+        << literal("Acesso fora da pilha (" + std::to_string(positions) + " posições)") << ";\n";
+    out << PRELUDE;
+    Translator(out, program).run();
+    out << EXPORTS;
+}
+
+void compileAot(const Program& program, const std::string& output, const AotOptions& options) {
+    const bool sourceOnly = endsWith(output, ".cpp");
+    const bool shared = endsWith(output, ".so") || endsWith(output, ".dll");
+    const std::string source = sourceOnly ? output : output + ".cpp";
+
+    {
+        std::ofstream file(source);
+        writeAotSource(file, program, options.stackSize);
+        if (!file) {
+            throw std::runtime_error("Não foi possível gravar o arquivo: " + source);
+        }
+    }
+    if (sourceOnly) {
+        return;
+    }
+
+    std::string compiler = options.compiler;
+    if (compiler.empty()) {
+        const char* cxx = std::getenv("CXX");
+        compiler = cxx && *cxx ? cxx : "g++";
+    }
+    const std::string command = compiler + " -O2" + (shared ? " -shared -fPIC -DVM_AOT_LIBRARY" : "")
+        + " " + quote(source) + " -o " + quote(output);
+    if (std::system(command.c_str()) != 0) {
+        // o código fica para inspeção
+        throw std::runtime_error("Falha ao compilar o código gerado: " + command);
+    }
+    std::remove(source.c_str());
+}
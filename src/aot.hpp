@@ -0,0 +1,32 @@
+#ifndef AOT_HPP
+#define AOT_HPP
+
+#include <ostream>
+#include <string>
+#include "program.hpp"
+#include "vm_stack.hpp"
+
+// Tradução antecipada (vm --aot): o programa vira um arquivo C++ autônomo, sem a VM.
+// Cada instrução é um label de goto e os saltos são gotos diretos; CALL empilha o endereço
+// de retorno como a VM e RETURN volta por um switch sobre os endereços do programa. A pilha
+// é um vetor de stackSize posições (arredondado como em VMStack), com os mesmos erros
+// de execução da VM, inclusive acessos fora da pilha. As superinstruções são traduzidas
+// como as instruções originais; o compilador C++ faz o resto.
+//
+// O código gerado exporta a API antiga (initVM, executeVM, getVMError, getVMSp, getVMIp,
+// getVMStack, getVMStackView, getVMState), para substituir vm.so em main.py (initVM ignora o caminho e
+// só reinicia a execução), e, compilado como executável, um main igual ao de vm.
+// instructions em getVMState é sempre 0: o código nativo não conta instruções.
+void writeAotSource(std::ostream& out, const Program& program, size_t stackSize = DEFAULT_STACK_SIZE);
+
+struct AotOptions {
+    size_t stackSize = DEFAULT_STACK_SIZE;
+    std::string compiler; // vazio: $CXX ou g++
+};
+
+// Gera o código e o compila com o compilador do sistema: output terminado em .cpp só grava
+// o código; em .so ou .dll gera uma biblioteca compartilhada; senão, um executável.
+// Lança std::runtime_error se o compilador falhar.
+void compileAot(const Program& program, const std::string& output, const AotOptions& options = {});
+
+#endif // AOT_HPP
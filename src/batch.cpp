@@ -0,0 +1,233 @@
+#include "batch.hpp"
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include "program_cache.hpp"
+#include "thread_pool.hpp"
+
+namespace {
+
+// Entrada e saída do caso em execução na thread (ReadFn/WriteFn não recebem contexto)
+struct JobIO {
+    const std::vector<int>* input;
+    size_t next;
+    bool exhausted;
+    std::string* output;
+};
+
+thread_local JobIO* currentIO = nullptr;
+
+int batchRead() {
+    JobIO& io = *currentIO;
+    if (io.next >= io.input->size()) {
+        io.exhausted = true; // não dá para lançar exceção daqui (código JIT); o caso falha no final
+        return 0;
+    }
+    return (*io.input)[io.next++];
+}
+
+void batchWrite(int value) {
+    char buffer[16];
+    auto [end, ec] = std::to_chars(buffer, buffer + sizeof(buffer), value);
+    currentIO->output->append(buffer, end);
+    currentIO->output->push_back('\n');
+}
+
+std::vector<int> readInput(const std::string& path) {
+    std::string text = readFile(path);
+    std::vector<int> values;
+
+    const char* p = text.data();
+    const char* end = p + text.size();
+    while (p < end) {
+        while (p < end && std::isspace((unsigned char)*p)) p++;
+        if (p == end) break;
+
+        int value = 0;
+        auto [ptr, ec] = std::from_chars(p, end, value);
+        if (ec != std::errc()) {
+            throw std::invalid_argument("Entrada inválida em " + path + ": " + std::string(p, std::min<size_t>(end - p, 16)));
+        }
+        values.push_back(value);
+        p = ptr;
+    }
+    return values;
+}
+
+void appendValues(const int* values, size_t count, void* user) {
+    std::string& output = *static_cast<std::string*>(user);
+    for (size_t i = 0; i < count; i++) {
+        char buffer[16];
+        auto [end, ec] = std::to_chars(buffer, buffer + sizeof(buffer), values[i]);
+        output.append(buffer, end);
+        output.push_back('\n');
+    }
+}
+
+struct LoadedProgram {
+    std::shared_ptr<const Program> program;
+    std::string error;
+
+    // Execução até o primeiro RD, igual em todos os casos: cada caso parte deste estado
+    VMSnapshot start;
+    std::string startOutput;
+    std::string startError; // erro antes do primeiro RD (vale para todos os casos)
+};
+
+// Roda o programa sem entrada até ele pedir o primeiro valor (ou terminar)
+void runUntilInput(LoadedProgram& loaded, const BatchOptions& options) {
+    VirtualMachine vm(options.stackSize);
+    int buffer[256];
+    IOBuffers io;
+    io.output = buffer;
+    io.outputCapacity = std::size(buffer);
+    io.flush = appendValues;
+    io.user = &loaded.startOutput;
+    try {
+        vm.startVM(loaded.program);
+        vm.execute(io, options.engine);
+        appendValues(buffer, io.outputSize, &loaded.startOutput);
+        loaded.start = vm.snapshot();
+    } catch (const std::exception& ex) {
+        appendValues(buffer, io.outputSize, &loaded.startOutput);
+        loaded.startError = ex.what();
+    }
+}
+
+} // namespace
+
+std::vector<BatchJob> readManifest(const std::string& manifestPath) {
+    std::istringstream stream(readFile(manifestPath));
+    const std::filesystem::path base = std::filesystem::path(manifestPath).parent_path();
+    auto resolve = [&](const std::string& path) {
+        std::filesystem::path p(path);
+        return (p.is_absolute() ? p : base / p).string();
+    };
+
+    std::vector<BatchJob> jobs;
+    std::string line;
+    size_t lineNumber = 0;
+    while (std::getline(stream, line)) {
+        lineNumber++;
+        std::istringstream lineStream(line);
+        std::string program, input, output, extra;
+        lineStream >> program >> input >> output >> extra;
+
+        if (program.empty() || program[0] == '#') continue;
+        if (input.empty() || !extra.empty()) {
+            throw std::invalid_argument("Linha inválida no manifesto (linha " + std::to_string(lineNumber) + ")");
+        }
+        jobs.push_back({resolve(program), resolve(input), output.empty() ? "" : resolve(output)});
+    }
+    return jobs;
+}
+
+std::vector<BatchResult> runBatch(const std::vector<BatchJob>& jobs, const BatchOptions& options) {
+    std::vector<BatchResult> results(jobs.size());
+    WorkStealingPool pool(options.threads);
+
+    // cada programa é carregado uma vez, em paralelo, e executado até o primeiro RD
+    std::map<std::string, LoadedProgram> programs;
+    for (const auto& job : jobs) {
+        programs.try_emplace(job.program);
+    }
+    for (auto& [path, loaded] : programs) {
+        pool.submit([&path = path, &loaded = loaded, &options](unsigned) {
+            try {
+                loaded.program = programCache().load(path, options.load);
+            } catch (const std::exception& ex) {
+                loaded.error = ex.what();
+                return;
+            }
+            runUntilInput(loaded, options);
+        });
+    }
+    pool.wait();
+
+    // uma VM por worker, reaproveitada entre os casos
+    std::vector<std::unique_ptr<VirtualMachine>> machines(pool.size());
+
+    for (size_t i = 0; i < jobs.size(); i++) {
+        pool.submit([&, i](unsigned worker) {
+            const BatchJob& job = jobs[i];
+            BatchResult& result = results[i];
+            const LoadedProgram& loaded = programs.at(job.program);
+
+            try {
+                if (!loaded.program) {
+                    throw std::runtime_error(loaded.error);
+                }
+                std::vector<int> input = readInput(job.input);
+
+                result.output = loaded.startOutput;
+                if (!loaded.startError.empty()) {
+                    throw std::runtime_error(loaded.startError);
+                }
+                JobIO io{&input, 0, false, &result.output};
+                result.dispatches = loaded.start.dispatches;
+
+                // programas que terminam sem ler nada têm o mesmo resultado em todos os casos
+                if (loaded.start.status == ExecStatus::NeedsInput) {
+                    if (!machines[worker]) {
+                        machines[worker] = std::make_unique<VirtualMachine>(options.stackSize);
+                    }
+                    VirtualMachine& vm = *machines[worker];
+                    vm.restore(loaded.start); // a pilha volta ao estado do primeiro RD
+
+                    currentIO = &io;
+                    try {
+                        vm.execute(batchRead, batchWrite, options.engine);
+                    } catch (...) {
+                        currentIO = nullptr;
+                        throw;
+                    }
+                    currentIO = nullptr;
+                    result.dispatches = vm.dispatches;
+                }
+
+                if (io.exhausted) {
+                    throw std::runtime_error("Entrada insuficiente: " + job.input);
+                }
+                if (!job.output.empty()) {
+                    std::ofstream file(job.output, std::ios::binary);
+                    file << result.output;
+                    if (!file) {
+                        throw std::runtime_error("Não foi possível gravar o arquivo: " + job.output);
+                    }
+                }
+                result.ok = true;
+            } catch (const std::exception& ex) {
+                result.error = ex.what();
+            }
+        });
+    }
+    pool.wait();
+
+    return results;
+}
+
+void writeBatchReport(std::ostream& out, const std::vector<BatchJob>& jobs, const std::vector<BatchResult>& results) {
+    for (size_t i = 0; i < jobs.size(); i++) {
+        const BatchJob& job = jobs[i];
+        const BatchResult& result = results[i];
+
+        out << "[" << i + 1 << "] " << job.program << " < " << job.input << ": ";
+        if (result.ok) {
+            out << "ok, " << result.dispatches << " despachos";
+        } else {
+            out << "erro: " << result.error;
+        }
+        if (!job.output.empty()) {
+            out << " -> " << job.output << "\n";
+        } else {
+            out << "\n" << result.output;
+        }
+    }
+}
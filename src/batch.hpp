@@ -0,0 +1,49 @@
+#ifndef BATCH_HPP
+#define BATCH_HPP
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+#include "loader.hpp"
+#include "vm.hpp"
+
+// Um caso do lote: programa, arquivo de entrada (inteiros separados por espaço) e,
+// opcionalmente, o arquivo onde a saída é gravada
+struct BatchJob {
+    std::string program;
+    std::string input;
+    std::string output; // vazio: a saída vai para o relatório
+};
+
+struct BatchResult {
+    bool ok = false;
+    std::string output; // valores escritos por PRN, um por linha
+    std::string error;
+    uint64_t dispatches = 0;
+};
+
+struct BatchOptions {
+    Engine engine = DEFAULT_ENGINE;
+    unsigned threads = 0; // 0: um worker por núcleo
+    size_t stackSize = DEFAULT_STACK_SIZE;
+    LoadOptions load;
+};
+
+// Manifesto: uma linha por caso, "<programa> <entrada> [saida]"; linhas vazias e
+// iniciadas por '#' são ignoradas. Caminhos relativos partem do diretório do manifesto.
+std::vector<BatchJob> readManifest(const std::string& manifestPath);
+
+// Executa os casos num pool com roubo de tarefas (thread_pool.hpp). Cada programa é
+// carregado uma vez (pelo cache de programas, program_cache.hpp) e compartilhado; cada
+// worker reaproveita a sua VirtualMachine.
+// O trecho antes do primeiro RD não depende da entrada: roda uma vez por programa e cada
+// caso continua de um snapshot desse ponto (VMSnapshot), com a saída dele já escrita.
+// Os resultados seguem a ordem dos casos.
+std::vector<BatchResult> runBatch(const std::vector<BatchJob>& jobs, const BatchOptions& options = {});
+
+// Relatório combinado: uma linha de status por caso, seguida da saída quando ela não
+// foi gravada num arquivo próprio
+void writeBatchReport(std::ostream& out, const std::vector<BatchJob>& jobs, const std::vector<BatchResult>& results);
+
+#endif // BATCH_HPP
@@ -0,0 +1,61 @@
+#include "bytecode.hpp"
+#include "program.hpp"
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <vector>
+
+bool isBytecode(std::string_view content) {
+    return content.size() >= sizeof(BYTECODE_MAGIC)
+        && std::memcmp(content.data(), BYTECODE_MAGIC, sizeof(BYTECODE_MAGIC)) == 0;
+}
+
+static uint64_t alignTo(uint64_t offset, uint64_t alignment) {
+    return (offset + alignment - 1) / alignment * alignment;
+}
+
+void writeBytecode(const Program& program, const std::string& filePath, bool withNames) {
+    std::vector<BytecodeLabel> labels;
+    std::string names;
+    for (const auto& [name, address] : program.labels()) {
+        BytecodeLabel label{address, 0, 0};
+        if (withNames) {
+            label.nameOffset = names.size();
+            label.nameLength = name.size();
+            names += name;
+        }
+        labels.push_back(label);
+    }
+
+    BytecodeHeader header{};
+    std::memcpy(header.magic, BYTECODE_MAGIC, sizeof(BYTECODE_MAGIC));
+    header.version = BYTECODE_VERSION;
+    header.instructionCount = program.size();
+    header.labelCount = labels.size();
+    header.codeOffset = alignTo(sizeof(BytecodeHeader), 16);
+    header.labelOffset = alignTo(header.codeOffset + (uint64_t(program.size()) + 1) * sizeof(DecodedInstruction), 16);
+    if (withNames) {
+        header.namesOffset = header.labelOffset + labels.size() * sizeof(BytecodeLabel);
+        header.namesSize = names.size();
+    }
+
+    std::ofstream file(filePath, std::ios::binary | std::ios::trunc);
+    if (!file) {
+        throw std::runtime_error("Não foi possível criar o arquivo: " + filePath);
+    }
+
+    auto padTo = [&file](uint64_t offset) {
+        while ((uint64_t)file.tellp() < offset) file.put('\0');
+    };
+
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    padTo(header.codeOffset);
+    file.write(reinterpret_cast<const char*>(program.code()), (uint64_t(program.size()) + 1) * sizeof(DecodedInstruction));
+    padTo(header.labelOffset);
+    file.write(reinterpret_cast<const char*>(labels.data()), labels.size() * sizeof(BytecodeLabel));
+    file.write(names.data(), names.size());
+
+    if (!file) {
+        throw std::runtime_error("Erro ao gravar o arquivo: " + filePath);
+    }
+}
@@ -0,0 +1,43 @@
+#ifndef BYTECODE_HPP
+#define BYTECODE_HPP
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+class Program;
+
+// Formato binário do programa (little-endian), pensado para ser mapeado com mmap
+// e executado sem parsing nem cópia:
+//
+//   BytecodeHeader
+//   DecodedInstruction[instructionCount + 1]   (alinhado a 16; o último é END)
+//   BytecodeLabel[labelCount]                  (labels já resolvidos para endereços)
+//   nomes dos labels                           (seção de debug opcional)
+struct BytecodeHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t instructionCount; // sem contar o END final
+    uint32_t labelCount;
+    uint64_t codeOffset;
+    uint64_t labelOffset;
+    uint64_t namesOffset; // 0 quando o arquivo não tem a seção de debug
+    uint64_t namesSize;
+};
+
+struct BytecodeLabel {
+    int32_t address;     // índice da linha do label
+    uint32_t nameOffset; // relativo ao início da seção de nomes
+    uint32_t nameLength;
+};
+
+constexpr char BYTECODE_MAGIC[4] = {'V', 'M', 'B', 'C'};
+constexpr uint32_t BYTECODE_VERSION = 1;
+
+// Verifica se o conteúdo começa com o cabeçalho do formato binário
+bool isBytecode(std::string_view content);
+
+// Grava o programa no formato binário (withNames inclui a seção de debug)
+void writeBytecode(const Program& program, const std::string& filePath, bool withNames = true);
+
+#endif // BYTECODE_HPP
@@ -0,0 +1,594 @@
+#include "jit.hpp"
+
+#ifdef VM_HAS_JIT
+
+#include <cstddef>
+#include <cstring>
+#include <initializer_list>
+#include <stdexcept>
+#include <sys/mman.h>
+#include "peephole.hpp"
+#include "program.hpp"
+#include "vm.hpp"
+
+namespace {
+
+enum Reg : int { RAX = 0, RCX = 1, RDX = 2, RBX = 3, RSP = 4, RBP = 5, RSI = 6, RDI = 7, R8 = 8, R12 = 12, R13 = 13, R14 = 14, R15 = 15 };
+
+// Operando de memória [base + index*scale + disp] (index < 0: sem índice)
+struct Mem {
+    int base;
+    int index;
+    int scale;
+    int32_t disp;
+};
+
+// Registradores fixos do código gerado (todos preservados pelos callbacks):
+//   rbx = base da pilha, r12 = sp (64 bits), r13 = JitContext*, r14 = tabela de entradas,
+//   r15 = contador de despachos, rbp = limite de despachos
+// Cache do topo (não preservado pelos callbacks): esi = stack[sp], r8d = stack[sp - 1]
+Mem top(int32_t disp = 0) { return {RBX, R12, 4, disp}; }
+Mem slot(int32_t address) { return {RBX, -1, 0, address * 4}; }
+Mem ctx(size_t offset) { return {R13, -1, 0, (int32_t)offset}; }
+
+class Assembler {
+public:
+    std::vector<uint8_t> code;
+
+    size_t pos() const { return code.size(); }
+    void byte(uint8_t b) { code.push_back(b); }
+    void bytes(std::initializer_list<uint8_t> bs) { code.insert(code.end(), bs); }
+    void imm32(int32_t value) {
+        for (int i = 0; i < 4; i++) byte(uint8_t(uint32_t(value) >> (8 * i)));
+    }
+
+    // instrução com operando registrador (campo reg do ModRM) e memória
+    void rm(std::initializer_list<uint8_t> opcode, int reg, Mem m, bool wide = false) {
+        uint8_t rex = 0x40 | (wide ? 8 : 0) | ((reg & 8) ? 4 : 0)
+            | ((m.index >= 0 && (m.index & 8)) ? 2 : 0) | ((m.base & 8) ? 1 : 0);
+        if (rex != 0x40) byte(rex);
+        bytes(opcode);
+
+        int mod = (m.disp == 0 && (m.base & 7) != RBP) ? 0 : (m.disp >= -128 && m.disp <= 127) ? 1 : 2;
+        if (m.index < 0 && (m.base & 7) != RSP) {
+            byte(mod << 6 | (reg & 7) << 3 | (m.base & 7));
+        } else {
+            int index = m.index < 0 ? RSP : m.index;
+            int ss = m.scale == 8 ? 3 : m.scale == 4 ? 2 : m.scale == 2 ? 1 : 0;
+            byte(mod << 6 | (reg & 7) << 3 | RSP);
+            byte(ss << 6 | (index & 7) << 3 | (m.base & 7));
+        }
+        if (mod == 1) byte(uint8_t(m.disp));
+        else if (mod == 2) imm32(m.disp);
+    }
+
+    // instrução com dois registradores (ModRM com mod = 11)
+    void rr(std::initializer_list<uint8_t> opcode, int reg, int rmReg, bool wide = false) {
+        uint8_t rex = 0x40 | (wide ? 8 : 0) | ((reg & 8) ? 4 : 0) | ((rmReg & 8) ? 1 : 0);
+        if (rex != 0x40) byte(rex);
+        bytes(opcode);
+        byte(0xC0 | (reg & 7) << 3 | (rmReg & 7));
+    }
+
+    void load(int reg, Mem m) { rm({0x8B}, reg, m); }
+    void store(Mem m, int reg) { rm({0x89}, reg, m); }
+    void storeImm(Mem m, int32_t value) { rm({0xC7}, 0, m); imm32(value); }
+    void incSp() { rr({0xFF}, 0, R12, true); }
+    void decSp() { rr({0xFF}, 1, R12, true); }
+    void movImm64(int reg, uint64_t value) {
+        byte(0x48 | ((reg & 8) ? 1 : 0)); byte(0xB8 | (reg & 7));
+        for (int i = 0; i < 8; i++) byte(uint8_t(value >> (8 * i)));
+    }
+    void push(int reg) { if (reg & 8) byte(0x41); byte(0x50 | (reg & 7)); }
+    void pop(int reg) { if (reg & 8) byte(0x41); byte(0x58 | (reg & 7)); }
+
+    // salto relativo (rel32) a ser corrigido depois; retorna a posição do deslocamento
+    size_t jmp() { byte(0xE9); imm32(0); return pos() - 4; }
+    size_t jcc(uint8_t cc) { bytes({0x0F, uint8_t(0x80 | cc)}); imm32(0); return pos() - 4; }
+
+    void patch(size_t at, size_t target) {
+        int32_t rel = (int32_t)(target - (at + 4));
+        std::memcpy(&code[at], &rel, 4);
+    }
+};
+
+// códigos de condição (jcc/setcc)
+constexpr uint8_t CC_B = 0x2, CC_AE = 0x3, CC_E = 0x4, CC_NE = 0x5, CC_LE = 0xE, CC_L = 0xC, CC_G = 0xF, CC_GE = 0xD;
+
+// ALLOC/DALLOC maiores chamam pushFrame/popFrame (vm_stack.hpp) em vez de uma sequência de
+// loads e stores
+constexpr int MAX_UNROLLED_FRAME = 32;
+
+} // namespace
+
+JitCode::JitCode(const Program& program, bool budgeted) {
+    const DecodedInstruction* code = program.code();
+    const unsigned size = program.size();
+#ifdef VM_HAS_GUARDED_STACK
+    // pilha provada no carregamento: sem checagens de valores insuficientes (ver VirtualMachine::checked)
+    const bool checked = !program.stackVerified();
+#else
+    const bool checked = true;
+#endif
+    Assembler a;
+
+    struct Patch { size_t at; unsigned target; };
+    std::vector<Patch> jumps;        // desvios para instruções do programa
+    std::vector<Patch> deopts;       // saídas para o interpretador (target = endereço)
+    std::vector<Patch> blocked;      // E/S bloqueada em RD/PRN (target = endereço)
+    std::vector<Patch> budget;       // limite de instruções (target = endereço)
+    std::vector<bool> blockedCounted(size, false); // o despacho da instrução bloqueada é desfeito
+    std::vector<size_t> toEpilogue;  // saídas para o epílogo
+    std::vector<size_t> toReturnOut; // RETURN para fora do programa
+    std::vector<size_t> offsets(size + 1);
+
+    // prólogo: salva registradores, carrega o contexto e salta para a instrução ip
+    a.push(RBX); a.push(RBP); a.push(R12); a.push(R13); a.push(R14); a.push(R15);
+    a.bytes({0x48, 0x83, 0xEC, 0x08}); // sub rsp, 8 (alinhamento para as chamadas)
+    a.rr({0x89}, RDI, R13, true);     // mov r13, rdi
+    a.rm({0x8B}, RBX, ctx(offsetof(JitContext, stack)), true);
+    a.rm({0x63}, R12, ctx(offsetof(JitContext, sp)), true); // movsxd r12, [sp]
+    a.rm({0x8B}, R14, ctx(offsetof(JitContext, entries)), true);
+    a.rm({0x8B}, R15, ctx(offsetof(JitContext, dispatches)), true);
+    a.rm({0x8B}, RBP, ctx(offsetof(JitContext, limit)), true);
+    a.load(RAX, ctx(offsetof(JitContext, ip)));
+    a.rm({0xFF}, 4, {R14, RAX, 8, 0}); // jmp [r14 + rax*8]
+
+    auto exitTo = [&](int32_t ip, int32_t status) {
+        a.storeImm(ctx(offsetof(JitContext, ip)), ip);
+        a.byte(0xB8); a.imm32(status); // mov eax, status
+        toEpilogue.push_back(a.jmp());
+    };
+    auto deopt = [&](uint8_t cc, unsigned address) {
+        deopts.push_back({a.jcc(cc), address});
+    };
+    auto jumpTo = [&](unsigned target) {
+        jumps.push_back({a.jmp(), target});
+    };
+    // registradores visíveis para o host durante RD/PRN
+    auto syncForCallback = [&](int32_t ip) {
+        a.rm({0x8B}, RAX, ctx(offsetof(JitContext, vmIp)), true);
+        a.storeImm({RAX, -1, 0, 0}, ip);
+        a.rm({0x8B}, RAX, ctx(offsetof(JitContext, vmSp)), true);
+        a.store({RAX, -1, 0, 0}, R12);
+    };
+    // depois do callback: se a E/S bloqueou, sai com ip na instrução (status fica na VM)
+    auto checkBlocked = [&](unsigned address, bool counted) {
+        a.rm({0x8B}, RCX, ctx(offsetof(JitContext, status)), true);
+        a.rm({0x83}, 7, {RCX, -1, 0, 0});  // cmp dword [rcx], Running
+        a.byte((uint8_t)ExecStatus::Running);
+        blocked.push_back({a.jcc(CC_NE), address});
+        blockedCounted[address] = counted;
+    };
+    // Cache do topo da pilha: quantos elementos do topo (0, 1 ou 2) estão em esi/r8d no
+    // ponto atual do código gerado, conhecido na compilação. Toda escrita vai também para a
+    // memória (as posições acima do topo são observáveis), então as saídas não precisam
+    // descarregar nada; o cache só evita reler da memória o que acabou de ser escrito.
+    int cached = 0;
+    std::vector<uint8_t> cachedAtStart(size, 0);
+
+    auto ensure = [&](int count) {
+        if (cached == 0 && count >= 1) {
+            a.load(RSI, top());
+            cached = 1;
+        }
+        if (cached == 1 && count >= 2) {
+            a.load(R8, top(-4));
+            cached = 2;
+        }
+    };
+    // empilha o valor que setValue coloca em esi
+    auto push = [&](auto setValue) {
+        if (cached >= 1) a.rr({0x89}, RSI, R8); // mov r8d, esi
+        setValue();
+        a.incSp();
+        a.store(top(), RSI);
+        cached = cached >= 1 ? 2 : 1;
+    };
+    auto pop = [&] {
+        a.decSp();
+        if (cached == 2) {
+            a.rr({0x89}, R8, RSI); // mov esi, r8d
+            cached = 1;
+        } else {
+            cached = 0;
+        }
+    };
+    // resultado da operação binária em esi: grava no lugar do segundo operando e desempilha
+    auto binaryResult = [&] {
+        a.store(top(-4), RSI);
+        a.decSp();
+        cached = 1;
+    };
+
+    auto checkBinary = [&](unsigned address) {
+        if (!checked) return;
+        a.rm({0x3B}, R12, ctx(offsetof(JitContext, minBinary)), true); // cmp r12, [minBinary]
+        deopt(CC_LE, address);
+    };
+    auto compare = [&](unsigned address, uint8_t cc) {
+        checkBinary(address);
+        ensure(2);
+        a.rr({0x3B}, R8, RSI);            // cmp r8d, esi
+        a.bytes({0x0F, uint8_t(0x90 | cc), 0xC0}); // setcc al
+        a.bytes({0x0F, 0xB6, 0xF0});      // movzx esi, al
+        binaryResult();
+    };
+    auto arith = [&](unsigned address, std::initializer_list<uint8_t> opcode) {
+        checkBinary(address);
+        ensure(2);
+        a.rr(opcode, R8, RSI);            // <op> r8d, esi
+        a.rr({0x89}, R8, RSI);            // mov esi, r8d
+        binaryResult();
+    };
+    auto logical = [&](unsigned address, uint8_t combine) {
+        checkBinary(address);
+        ensure(2);
+        a.rr({0x83}, 7, R8); a.byte(0x01); // cmp r8d, 1
+        a.bytes({0x0F, 0x94, 0xC0});       // sete al
+        a.bytes({0x83, 0xFE, 0x01});       // cmp esi, 1
+        a.bytes({0x0F, 0x94, 0xC1});       // sete cl
+        a.bytes({combine, 0xC8});          // and/or al, cl
+        a.bytes({0x0F, 0xB6, 0xF0});       // movzx esi, al
+        binaryResult();
+    };
+    auto addressable = [](int32_t address) {
+        return address > -(1 << 28) && address < (1 << 28);
+    };
+    auto frameAddressable = [&](const DecodedInstruction& instr) {
+        return addressable(instr.op1) && addressable(instr.op1 + instr.op2);
+    };
+    // quadros grandes: chamada com sp passado pela memória do contexto; a chamada não
+    // preserva esi/r8d, então o cache é descartado
+    auto callFrame = [&](const void* fn) {
+        a.rm({0x89}, R12, ctx(offsetof(JitContext, sp)));        // mov [sp], r12d
+        a.movImm64(RAX, (uint64_t)fn);
+        a.bytes({0xFF, 0xD0});                                    // call rax
+        a.rm({0x63}, R12, ctx(offsetof(JitContext, sp)), true);  // movsxd r12, [sp]
+        cached = 0;
+    };
+    auto allocFrame = [&](const DecodedInstruction& instr) {
+        if (instr.op2 <= MAX_UNROLLED_FRAME) {
+            for (int k = 0; k < instr.op2; k++) {
+                push([&] { a.load(RSI, slot(instr.op1 + k)); });
+            }
+            return;
+        }
+        // pushFrame(stack, stackSize, sp, m, n)
+        a.rr({0x89}, RBX, RDI, true);                                   // mov rdi, rbx
+        a.rm({0x8B}, RSI, ctx(offsetof(JitContext, stackSize)), true);
+        a.rm({0x8D}, RDX, ctx(offsetof(JitContext, sp)), true);        // lea rdx, [sp]
+        a.byte(0xB9); a.imm32(instr.op1);                               // mov ecx, m
+        a.bytes({0x41, 0xB8}); a.imm32(instr.op2);                      // mov r8d, n
+        callFrame((const void*)&pushFrame);
+    };
+    // métricas (VMStats) no contexto: profundidade de CALL e maior sp depois dos quadros
+    auto enterCall = [&] {
+        a.rm({0x8B}, RAX, ctx(offsetof(JitContext, callDepth)), true);
+        a.rr({0xFF}, 0, RAX, true);                                       // inc rax
+        a.rm({0x89}, RAX, ctx(offsetof(JitContext, callDepth)), true);
+        a.rm({0x3B}, RAX, ctx(offsetof(JitContext, maxCallDepth)), true); // cmp rax, [maxCallDepth]
+        const size_t lower = a.jcc(CC_LE);
+        a.rm({0x89}, RAX, ctx(offsetof(JitContext, maxCallDepth)), true);
+        a.patch(lower, a.pos());
+    };
+    auto frameTop = [&] {
+        a.rm({0x3B}, R12, ctx(offsetof(JitContext, maxSp)), true);        // cmp r12, [maxSp]
+        const size_t lower = a.jcc(CC_LE);
+        a.rm({0x89}, R12, ctx(offsetof(JitContext, maxSp)), true);
+        a.patch(lower, a.pos());
+    };
+    auto deallocFrame = [&](const DecodedInstruction& instr) {
+        if (instr.op2 <= MAX_UNROLLED_FRAME) {
+            // as escritas por endereço podem cair nas posições em cache
+            for (int k = instr.op2 - 1; k >= 0; k--) {
+                ensure(1);
+                a.store(slot(instr.op1 + k), RSI);
+                a.decSp();
+                cached = 0;
+            }
+            return;
+        }
+        // popFrame(stack, sp, m, n)
+        a.rr({0x89}, RBX, RDI, true);                                   // mov rdi, rbx
+        a.rm({0x8D}, RSI, ctx(offsetof(JitContext, sp)), true);        // lea rsi, [sp]
+        a.byte(0xBA); a.imm32(instr.op1);                               // mov edx, m
+        a.byte(0xB9); a.imm32(instr.op2);                               // mov ecx, n
+        callFrame((const void*)&popFrame);
+    };
+
+    // destinos de desvios começam sem cache (quem salta não sabe o que o outro lado espera)
+    std::vector<bool> leader(size, false);
+    for (unsigned i = 0; i < size; i++) {
+        OpCode op = code[i].opcode;
+        if ((op == OpCode::JMP || op == OpCode::JMPF || op == OpCode::CALL) && (unsigned)code[i].op1 < size) {
+            leader[code[i].op1] = true;
+        }
+        if (op == OpCode::CALL_ALLOC && (unsigned)code[i].op1 + 1 < size) {
+            leader[code[i].op1 + 1] = true;
+        }
+    }
+
+    unsigned coveredUntil = 0;
+    for (unsigned i = 0; i < size; i++) {
+        if (leader[i]) cached = 0;
+        cachedAtStart[i] = cached;
+        offsets[i] = a.pos();
+        const DecodedInstruction& instr = code[i];
+
+        // superinstruções: o código nativo das instruções originais já elimina o despacho;
+        // a cabeça é compilada como a instrução original e a sequência conta como um despacho
+        // (CALL_ALLOC, que não cobre as instruções seguintes, é compilado à parte)
+        OpCode op = instr.opcode;
+        const bool covered = i < coveredUntil;
+        if (fusedLength(op) > 1) {
+            coveredUntil = i + fusedLength(op);
+            op = originalOpcode(op);
+        }
+
+        if (budgeted && !covered) {
+            a.rr({0x39}, RBP, R15, true); // cmp r15, rbp
+            budget.push_back({a.jcc(CC_AE), i});
+        }
+
+        bool supported = true;
+        switch (op) {
+            case OpCode::DEBUG:
+            case OpCode::END:
+                supported = false;
+                break;
+            case OpCode::LDV:
+            case OpCode::STR:
+                supported = addressable(instr.op1);
+                break;
+            case OpCode::ALLOC:
+            case OpCode::DALLOC:
+                supported = frameAddressable(instr);
+                break;
+            case OpCode::CALL_ALLOC:
+                supported = frameAddressable(code[instr.op1]);
+                break;
+            default:
+                break;
+        }
+        if (!supported) {
+            exitTo(i, (int32_t)JitExit::Interpret);
+            cached = 0;
+            continue;
+        }
+
+        if (!covered) {
+            a.rr({0xFF}, 0, R15, true); // inc r15
+        }
+
+        switch (op) {
+            case OpCode::NOP:
+            case OpCode::START:
+                break;
+            case OpCode::HLT:
+                exitTo(i + 1, (int32_t)JitExit::Halted);
+                cached = 0;
+                break;
+            case OpCode::LDC:
+                push([&] { a.byte(0xBE); a.imm32(instr.op1); }); // mov esi, imm32
+                break;
+            case OpCode::LDV:
+                push([&] { a.load(RSI, slot(instr.op1)); });
+                break;
+            case OpCode::ADD: arith(i, {0x03}); break;
+            case OpCode::SUB: arith(i, {0x2B}); break;
+            case OpCode::MULT: arith(i, {0x0F, 0xAF}); break;
+            case OpCode::DIVI:
+                checkBinary(i);
+                ensure(2);
+                a.bytes({0x85, 0xF6});     // test esi, esi
+                deopt(CC_E, i);
+                a.rr({0x89}, R8, RAX);     // mov eax, r8d
+                a.byte(0x99);              // cdq
+                a.bytes({0xF7, 0xFE});     // idiv esi
+                a.bytes({0x89, 0xC6});     // mov esi, eax
+                binaryResult();
+                break;
+            case OpCode::INV:
+                ensure(1);
+                a.bytes({0xF7, 0xDE});     // neg esi
+                a.store(top(), RSI);
+                break;
+            case OpCode::AND: logical(i, 0x20); break;
+            case OpCode::OR: logical(i, 0x08); break;
+            case OpCode::NEG:
+                ensure(1);
+                a.byte(0xB8); a.imm32(1);  // mov eax, 1
+                a.bytes({0x29, 0xF0});     // sub eax, esi
+                a.bytes({0x89, 0xC6});     // mov esi, eax
+                a.store(top(), RSI);
+                break;
+            case OpCode::CME: compare(i, CC_L); break;
+            case OpCode::CMA: compare(i, CC_G); break;
+            case OpCode::CEQ: compare(i, CC_E); break;
+            case OpCode::CDIF: compare(i, CC_NE); break;
+            case OpCode::CMEQ: compare(i, CC_LE); break;
+            case OpCode::CMAQ: compare(i, CC_GE); break;
+            case OpCode::JMP:
+                jumpTo(instr.op1);
+                cached = 0;
+                break;
+            case OpCode::JMPF:
+                if (checked) {
+                    a.rm({0x3B}, R12, ctx(offsetof(JitContext, minUnary)), true);
+                    deopt(CC_LE, i);
+                }
+                ensure(1);
+                a.bytes({0x89, 0xF0});     // mov eax, esi
+                pop();
+                a.bytes({0x85, 0xC0});     // test eax, eax
+                jumps.push_back({a.jcc(CC_E), (unsigned)instr.op1});
+                break;
+            case OpCode::ALLOC:
+                allocFrame(instr);
+                frameTop();
+                break;
+            case OpCode::DALLOC:
+                deallocFrame(instr);
+                break;
+            case OpCode::RD:
+                syncForCallback(i + 1);
+                a.rm({0xFF}, 2, ctx(offsetof(JitContext, readFn))); // call [readFn]
+                checkBlocked(i, !covered);
+                cached = 0;
+                push([&] { a.bytes({0x89, 0xC6}); }); // mov esi, eax
+                break;
+            case OpCode::PRN:
+                syncForCallback(i + 1);
+                ensure(1);
+                a.bytes({0x89, 0xF7});     // mov edi, esi
+                a.rm({0xFF}, 2, ctx(offsetof(JitContext, writeFn))); // call [writeFn]
+                checkBlocked(i, !covered);
+                a.decSp();
+                cached = 0; // o callback não preserva esi/r8d e pode alterar a pilha
+                break;
+            case OpCode::STR:
+                ensure(1);
+                a.store(slot(instr.op1), RSI);
+                a.decSp();
+                cached = 0; // o endereço pode ser uma das posições em cache
+                break;
+            case OpCode::CALL:
+                a.incSp();
+                a.storeImm(top(), i + 1);
+                enterCall();
+                frameTop();
+                jumpTo(instr.op1);
+                cached = 0;
+                break;
+            case OpCode::CALL_ALLOC:
+                a.incSp();
+                a.storeImm(top(), i + 1);
+                cached = 0;
+                allocFrame(code[instr.op1]);
+                enterCall();
+                frameTop();
+                jumpTo(instr.op1 + 1);
+                cached = 0;
+                break;
+            case OpCode::RETURN:
+                a.rm({0xFF}, 1, ctx(offsetof(JitContext, callDepth)), true); // dec qword [callDepth]
+                if (cached >= 1) {
+                    a.bytes({0x89, 0xF0}); // mov eax, esi
+                } else {
+                    a.load(RAX, top());
+                }
+                a.decSp();
+                cached = 0;
+                a.byte(0x3D); a.imm32(size); // cmp eax, size
+                toReturnOut.push_back(a.jcc(CC_AE));
+                a.rm({0xFF}, 4, {R14, RAX, 8, 0}); // jmp [r14 + rax*8]
+                break;
+            default:
+                break;
+        }
+    }
+
+    // fim do programa (o END não conta como despacho)
+    offsets[size] = a.pos();
+    exitTo(size, (int32_t)JitExit::Halted);
+
+    // RETURN para fora do programa: para com ip = endereço de retorno
+    const size_t returnOut = a.pos();
+    a.store(ctx(offsetof(JitContext, ip)), RAX);
+    a.bytes({0x31, 0xC0}); // xor eax, eax
+    toEpilogue.push_back(a.jmp());
+
+    // saídas para o interpretador: desfaz a contagem, que o interpretador refaz
+    std::vector<size_t> stubs(size, 0);
+    for (const Patch& p : deopts) {
+        if (!stubs[p.target]) {
+            stubs[p.target] = a.pos();
+            a.rr({0xFF}, 1, R15, true); // dec r15
+            exitTo(p.target, (int32_t)JitExit::Interpret);
+        }
+        a.patch(p.at, stubs[p.target]);
+    }
+
+    // limite de instruções: a próxima execução começa na instrução
+    std::vector<size_t> budgetStubs(size, 0);
+    for (const Patch& p : budget) {
+        if (!budgetStubs[p.target]) {
+            budgetStubs[p.target] = a.pos();
+            exitTo(p.target, (int32_t)JitExit::Budget);
+        }
+        a.patch(p.at, budgetStubs[p.target]);
+    }
+
+    // E/S bloqueada: a instrução é refeita na próxima execução
+    std::vector<size_t> blockedStubs(size, 0);
+    for (const Patch& p : blocked) {
+        if (!blockedStubs[p.target]) {
+            blockedStubs[p.target] = a.pos();
+            if (blockedCounted[p.target]) {
+                a.rr({0xFF}, 1, R15, true); // dec r15
+            }
+            exitTo(p.target, (int32_t)JitExit::Halted);
+        }
+        a.patch(p.at, blockedStubs[p.target]);
+    }
+
+    // entradas pela tabela (retomada, RETURN, volta do interpretador) no meio de um trecho
+    // com cache: carregam esi/r8d antes; sem os valores na pilha, o interpretador executa
+    std::vector<size_t> entryOffsets(offsets);
+    for (unsigned i = 0; i < size; i++) {
+        if (cachedAtStart[i] == 0) continue;
+        entryOffsets[i] = a.pos();
+        a.rr({0x83}, 7, R12, true); a.byte(cachedAtStart[i] - 1); // cmp r12, n - 1
+        const size_t enough = a.jcc(CC_GE);
+        exitTo(i, (int32_t)JitExit::Interpret);
+        a.patch(enough, a.pos());
+        a.load(RSI, top());
+        if (cachedAtStart[i] == 2) a.load(R8, top(-4));
+        jumpTo(i);
+    }
+
+    // epílogo
+    const size_t epilogue = a.pos();
+    a.store(ctx(offsetof(JitContext, sp)), R12);
+    a.rm({0x89}, R15, ctx(offsetof(JitContext, dispatches)), true);
+    a.bytes({0x48, 0x83, 0xC4, 0x08}); // add rsp, 8
+    a.pop(R15); a.pop(R14); a.pop(R13); a.pop(R12); a.pop(RBP); a.pop(RBX);
+    a.byte(0xC3);
+
+    for (const Patch& p : jumps) a.patch(p.at, offsets[p.target]);
+    for (size_t at : toEpilogue) a.patch(at, epilogue);
+    for (size_t at : toReturnOut) a.patch(at, returnOut);
+
+    // copia para memória executável (escrita e execução nunca ao mesmo tempo)
+    this->length = a.code.size();
+    this->memory = mmap(nullptr, this->length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (this->memory == MAP_FAILED) {
+        this->memory = nullptr;
+        throw std::runtime_error("JIT: não foi possível alocar memória executável");
+    }
+    std::memcpy(this->memory, a.code.data(), this->length);
+    if (mprotect(this->memory, this->length, PROT_READ | PROT_EXEC) != 0) {
+        munmap(this->memory, this->length);
+        this->memory = nullptr;
+        throw std::runtime_error("JIT: não foi possível tornar o código executável");
+    }
+
+    this->entryTable.resize(size + 1);
+    for (unsigned i = 0; i <= size; i++) {
+        this->entryTable[i] = static_cast<const uint8_t*>(this->memory) + entryOffsets[i];
+    }
+}
+
+JitCode::~JitCode() {
+    if (this->memory) {
+        munmap(this->memory, this->length);
+    }
+}
+
+JitExit JitCode::run(JitContext& context) const {
+    using Entry = int32_t (*)(JitContext*);
+    return static_cast<JitExit>(reinterpret_cast<Entry>(this->memory)(&context));
+}
+
+#endif // VM_HAS_JIT
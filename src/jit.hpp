@@ -0,0 +1,67 @@
+#ifndef JIT_HPP
+#define JIT_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class Program;
+enum class ExecStatus : int32_t;
+
+typedef int(*ReadFn)();
+typedef void(*WriteFn)(int);
+
+// JIT para x86-64 (System V): só em Linux/Unix x86-64 com GCC/Clang
+#if defined(__x86_64__) && !defined(_WIN32) && !defined(VM_NO_JIT)
+#define VM_HAS_JIT 1
+#endif
+
+// Estado trocado entre a VM e o código nativo (offsets fixos, usados pelo código gerado)
+struct JitContext {
+    int* stack;                 // base da pilha da VM
+    const void* const* entries; // endereço nativo de cada instrução (size + 1)
+    int* vmIp;                  // registradores da VM, atualizados antes dos callbacks
+    int* vmSp;
+    ReadFn readFn;
+    WriteFn writeFn;
+    uint64_t dispatches;
+    int64_t minUnary;  // start_sp: JMPF precisa de sp > minUnary
+    int64_t minBinary; // start_sp + 1: operações binárias precisam de sp > minBinary
+    int32_t ip;        // entrada: instrução inicial; saída: onde parou
+    int32_t sp;
+    const ExecStatus* status; // diferente de Running depois de RD/PRN: a E/S bloqueou (sai com ip na instrução)
+    uint64_t limit;           // sai com Budget antes de despachar com dispatches == limit
+    size_t stackSize;         // para pushFrame (ALLOC com quadros grandes)
+    int64_t callDepth;        // métricas da VM (VMStats), atualizadas em CALL, ALLOC e RETURN
+    int64_t maxCallDepth;
+    int64_t maxSp;
+};
+
+// Resultado de uma execução nativa
+enum class JitExit : int32_t {
+    Halted = 0,    // HLT, fim do programa ou RETURN para fora dele
+    Interpret = 1, // a instrução em ip precisa do interpretador (DEBUG, erro, não suportada)
+    Budget = 2,    // limite de instruções atingido antes da instrução em ip
+};
+
+// Programa traduzido para código nativo num buffer executável (mmap).
+// A pilha continua na memória da VM (vm.stack), com sp num registrador.
+class JitCode {
+public:
+    // budgeted: checa JitContext::limit antes de cada instrução (senão ele é ignorado)
+    JitCode(const Program& program, bool budgeted);
+    ~JitCode();
+
+    JitCode(const JitCode&) = delete;
+    JitCode& operator=(const JitCode&) = delete;
+
+    JitExit run(JitContext& context) const;
+    const void* const* entries() const { return entryTable.data(); }
+
+private:
+    void* memory = nullptr;
+    size_t length = 0;
+    std::vector<const void*> entryTable;
+};
+
+#endif // JIT_HPP
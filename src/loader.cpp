@@ -0,0 +1,98 @@
+#include "loader.hpp"
+#include "mapped_file.hpp"
+#include <iostream>
+#include <fstream>
+#include <sstream>
+
+// Função para ler o conteúdo de um arquivo e retorná-lo como string
+std::string readFile(const std::string& filePath) {
+    std::ifstream file(filePath);
+    if (!file) {
+        throw std::runtime_error("Não foi possível abrir o arquivo: " + filePath);
+    }
+
+    std::stringstream buffer;
+    buffer << file.rdbuf();
+    return buffer.str();
+}
+
+// Função para fazer o parsing do conteúdo do arquivo em uma lista de instruções
+std::vector<Instruction> parseInstructions(const std::string& fileContent) {
+    std::vector<Instruction> instructions;
+    std::istringstream stream(fileContent);
+    std::string line;
+
+    while (std::getline(stream, line)) {
+        if (line.empty()) continue; // Ignora linhas vazias
+
+        std::istringstream lineStream(line);
+        std::string word1, word2;
+
+        lineStream >> word1 >> word2;
+
+        if (word2 == "NULL") {
+            // Linha representa um label
+            instructions.push_back({word1, "", std::nullopt, std::nullopt});
+        } else {
+            // Linha representa uma instrução
+            std::optional<std::string> op1 = std::nullopt, op2 = std::nullopt;
+
+            size_t commaPos = word2.find(',');
+            if (commaPos != std::string::npos) {
+                op1 = word2.substr(0, commaPos);
+                op2 = word2.substr(commaPos + 1);
+                // Remove espaços extras
+                if (op1) *op1 = std::string(op1->begin() + (op1->front() == ' ' ? 1 : 0), op1->end());
+                if (op2) *op2 = std::string(op2->begin() + (op2->front() == ' ' ? 1 : 0), op2->end());
+            } else if (!word2.empty()) {
+                op1 = word2;
+            }
+
+            instructions.push_back({
+                std::nullopt, 
+                word1, 
+                op1, 
+                op2
+            });
+        }
+    }
+
+    return instructions;
+}
+
+void debugInstructions(const std::vector<Instruction>& instructions) {
+    std::cout << "Debugging Instructions:\n";
+    for (const auto& instr : instructions) {
+        if (instr.label) {
+            std::cout << "Label: " << *instr.label << "; ";
+        }
+        std::cout << "Operation: " << instr.operation << "; ";
+        if (instr.op1) {
+            std::cout << "OP1: " << *instr.op1 << "; ";
+        }
+        if (instr.op2) {
+            std::cout << "OP2: " << *instr.op2 << "; ";
+        }
+        std::cout << "\n---\n";
+    }
+}
+
+// Carrega um programa de um arquivo, no formato texto ou binário (detectado pelo cabeçalho).
+// O arquivo é mapeado: binários são executados direto das páginas mapeadas e
+// textos passam por parseProgram, sem cópias intermediárias.
+std::shared_ptr<const Program> loadProgram(const std::string& filePath, const LoadOptions& options) {
+    return loadProgram(MappedFile(filePath), options);
+}
+
+std::shared_ptr<const Program> loadProgram(MappedFile file, const LoadOptions& options) {
+    auto program = std::make_shared<Program>(std::move(file));
+
+    // otimizar copia as instruções de imagens binárias, que então também são fundidas
+    program->optimize(options.optimize);
+
+    // imagens binárias já saem do --compile com as superinstruções; fundir aqui exigiria copiá-las
+    if (options.fuse && !program->isMapped()) {
+        program->fuseSuperinstructions();
+    }
+    return program;
+}
@@ -0,0 +1,27 @@
+#ifndef LOADER_HPP
+#define LOADER_HPP
+
+#include <memory>
+#include <string>
+#include <vector>
+#include "program.hpp"
+
+// Função para ler o conteúdo de um arquivo e retorná-lo como string
+std::string readFile(const std::string& filePath);
+
+// Função para fazer o parsing do conteúdo do arquivo em uma lista de instruções
+std::vector<Instruction> parseInstructions(const std::string& fileContent);
+
+void debugInstructions(const std::vector<Instruction>& instructions);
+
+// Opções aplicadas ao carregar um programa
+struct LoadOptions {
+    bool fuse = true; // superinstruções (peephole.hpp); imagens binárias são usadas como estão
+    int optimize = 0; // nível do otimizador (optimizer.hpp); 0 desliga
+};
+
+// Carrega um programa de um arquivo, no formato texto ou binário
+std::shared_ptr<const Program> loadProgram(const std::string& filePath, const LoadOptions& options = {});
+std::shared_ptr<const Program> loadProgram(MappedFile file, const LoadOptions& options = {});
+
+#endif // LOADER_HPP
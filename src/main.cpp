@@ -1,119 +1,295 @@
+#include <algorithm>
+#include <chrono>
 #include <iostream>
 #include <fstream>
 #include <string>
 #include <vector>
 #include <sstream>
 #include <optional>
+#include <stdexcept>
 #include "vm.hpp"
+#include "vm_api.hpp"
+#include "loader.hpp"
+#include "aot.hpp"
+#include "batch.hpp"
+#include "bytecode.hpp"
+#include "trace.hpp"
+#include "stream_loader.hpp"
 
-VirtualMachine* vm; // global
 
-// Função para ler o conteúdo de um arquivo e retorná-lo como string
-std::string readFile(const std::string& filePath) {
-    std::ifstream file(filePath);
-    if (!file) {
-        throw std::runtime_error("Não foi possível abrir o arquivo: " + filePath);
-    }
-
-    std::stringstream buffer;
-    buffer << file.rdbuf();
-    return buffer.str();
-}
+int defaultReadFn(){
+    int var;
 
-// Função para fazer o parsing do conteúdo do arquivo em uma lista de instruções
-std::vector<Instruction> parseInstructions(const std::string& fileContent) {
-    std::vector<Instruction> instructions;
-    std::istringstream stream(fileContent);
-    std::string line;
+    std::cout << "> ";
+    std::cin >> var;
 
-    while (std::getline(stream, line)) {
-        if (line.empty()) continue; // Ignora linhas vazias
+    return var;
+}
 
-        std::istringstream lineStream(line);
-        std::string word1, word2;
+void defaultWriteFn(int var){
+    std::cout << var << "\n";
+}
 
-        lineStream >> word1 >> word2;
+void usage(const char* prog) {
+    std::cerr << "Uso: " << prog << " [--engine table|threaded|jit] [--stack N] [-O0|-O1|-O2] [--no-fuse] [--stats]\n"
+              << "       [--profile <relatorio.txt>] [--folded <pilhas.folded>] [--trace <registro>] [--metrics <metricas.json>]\n"
+              << "       [--stream] <caminho_do_arquivo>\n";
+    std::cerr << "     " << prog << " --replay <registro> [--seek N] [--stack N] [-O0|-O1|-O2] [--no-fuse] <caminho_do_arquivo>\n";
+    std::cerr << "     " << prog << " --compile <saida.vmb> [--strip] [-O0|-O1|-O2] <caminho_do_arquivo>\n";
+    std::cerr << "     " << prog << " --aot <saida|saida.so|saida.cpp> [--stack N] [-O0|-O1|-O2] <caminho_do_arquivo>\n";
+    std::cerr << "     " << prog << " --batch <manifesto> [--report <arquivo>] [--jobs N] [--engine ...] [--stack N] [-O0|-O1|-O2] [--no-fuse]\n";
+}
 
-        if (word2 == "NULL") {
-            // Linha representa um label
-            instructions.push_back({word1, "", std::nullopt, std::nullopt});
-        } else {
-            // Linha representa uma instrução
-            std::optional<std::string> op1 = std::nullopt, op2 = std::nullopt;
-
-            size_t commaPos = word2.find(',');
-            if (commaPos != std::string::npos) {
-                op1 = word2.substr(0, commaPos);
-                op2 = word2.substr(commaPos + 1);
-                // Remove espaços extras
-                if (op1) *op1 = std::string(op1->begin() + (op1->front() == ' ' ? 1 : 0), op1->end());
-                if (op2) *op2 = std::string(op2->begin() + (op2->front() == ' ' ? 1 : 0), op2->end());
-            } else if (!word2.empty()) {
-                op1 = word2;
-            }
+// Métricas da execução (VMStats) em JSON; ok = false se a execução terminou com erro
+void writeMetrics(std::ostream& out, const VirtualMachine& vm, bool ok) {
+    const VMStats& stats = vm.stats;
+    const uint64_t compute = stats.runNanoseconds - std::min(stats.ioNanoseconds, stats.runNanoseconds);
+    out << "{\n"
+        << "  \"ok\": " << (ok ? "true" : "false") << ",\n"
+        << "  \"instructions\": " << vm.dispatches << ",\n"
+        << "  \"call_depth\": " << stats.callDepth << ",\n"
+        << "  \"max_call_depth\": " << stats.maxCallDepth << ",\n"
+        << "  \"stack_high_water\": " << stats.maxSp + 1 << ",\n"
+        << "  \"reads\": " << stats.reads << ",\n"
+        << "  \"writes\": " << stats.writes << ",\n"
+        << "  \"io_ns\": " << stats.ioNanoseconds << ",\n"
+        << "  \"compute_ns\": " << compute << "\n"
+        << "}\n";
+}
 
-            instructions.push_back({
-                std::nullopt, 
-                word1, 
-                op1, 
-                op2
-            });
-        }
+template <typename Write>
+void writeProfile(const char* path, Write write) {
+    std::ofstream file(path);
+    write(file);
+    if (!file) {
+        throw std::runtime_error("Não foi possível gravar o arquivo: " + std::string(path));
     }
-
-    return instructions;
 }
 
-void debugInstructions(const std::vector<Instruction>& instructions) {
-    std::cout << "Debugging Instructions:\n";
-    for (const auto& instr : instructions) {
-        if (instr.label) {
-            std::cout << "Label: " << *instr.label << "; ";
-        }
-        std::cout << "Operation: " << instr.operation << "; ";
-        if (instr.op1) {
-            std::cout << "OP1: " << *instr.op1 << "; ";
+// Executa todos os casos do manifesto; o resumo vai para stderr
+int runBatchMode(const char* manifest, const char* report, const BatchOptions& options) {
+    try {
+        std::vector<BatchJob> jobs = readManifest(manifest);
+
+        auto start = std::chrono::steady_clock::now();
+        std::vector<BatchResult> results = runBatch(jobs, options);
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        if (report) {
+            std::ofstream file(report);
+            writeBatchReport(file, jobs, results);
+            if (!file) {
+                throw std::runtime_error("Não foi possível gravar o arquivo: " + std::string(report));
+            }
+        } else {
+            writeBatchReport(std::cout, jobs, results);
         }
-        if (instr.op2) {
-            std::cout << "OP2: " << *instr.op2 << "; ";
+
+        size_t failed = 0;
+        for (const auto& result : results) {
+            if (!result.ok) failed++;
         }
-        std::cout << "\n---\n";
+        std::cerr << jobs.size() << " casos, " << failed << " com erro, " << seconds << " s ("
+                  << (seconds > 0 ? jobs.size() / seconds : 0) << " casos/s)\n";
+        return failed ? 1 : 0;
+    } catch (const std::exception& ex) {
+        std::cerr << "Erro: " << ex.what() << std::endl;
+        return 1;
     }
 }
 
-int defaultReadFn(){
-    int var;
+int main(int argc, char* argv[]) {
+    const char* filePath = nullptr;
+    const char* compileOutput = nullptr;
+    const char* aotOutput = nullptr;
+    const char* batchManifest = nullptr;
+    const char* batchReport = nullptr;
+    unsigned batchThreads = 0;
+    size_t stackSize = DEFAULT_STACK_SIZE;
+    bool withNames = true;
+    bool stats = false;
+    bool stream = false;
+    const char* profileReport = nullptr;
+    const char* profileFolded = nullptr;
+    const char* tracePath = nullptr;
+    const char* metricsPath = nullptr;
+    const char* replayPath = nullptr;
+    uint64_t seek = UINT64_MAX;
+    LoadOptions options;
+    Engine engine = DEFAULT_ENGINE;
 
-    std::cout << "> ";
-    std::cin >> var;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
 
-    return var;
-}
+        if (arg == "--engine" && i + 1 < argc) {
+            std::string name = argv[++i];
+            if (name == "table") {
+                engine = Engine::Table;
+            } else if (name == "threaded") {
+#ifndef VM_HAS_THREADED_DISPATCH
+                std::cerr << "Motor threaded indisponível neste build\n";
+                return 1;
+#endif
+                engine = Engine::Threaded;
+            } else if (name == "jit") {
+#ifndef VM_HAS_JIT
+                std::cerr << "JIT indisponível neste build (requer x86-64)\n";
+                return 1;
+#endif
+                engine = Engine::Jit;
+            } else {
+                usage(argv[0]);
+                return 1;
+            }
+        } else if (arg == "--compile" && i + 1 < argc) {
+            compileOutput = argv[++i];
+        } else if (arg == "--aot" && i + 1 < argc) {
+            aotOutput = argv[++i];
+        } else if (arg == "--batch" && i + 1 < argc) {
+            batchManifest = argv[++i];
+        } else if (arg == "--report" && i + 1 < argc) {
+            batchReport = argv[++i];
+        } else if (arg == "--jobs" && i + 1 < argc) {
+            batchThreads = std::stoi(argv[++i]);
+        } else if (arg == "--stack" && i + 1 < argc) {
+            stackSize = std::stoul(argv[++i]);
+        } else if (arg == "--strip") {
+            withNames = false;
+        } else if (arg == "--no-fuse") {
+            options.fuse = false;
+        } else if (arg.size() == 3 && arg.compare(0, 2, "-O") == 0 && arg[2] >= '0' && arg[2] <= '0' + MAX_OPTIMIZATION_LEVEL) {
+            options.optimize = arg[2] - '0';
+        } else if (arg == "--profile" && i + 1 < argc) {
+            profileReport = argv[++i];
+        } else if (arg == "--folded" && i + 1 < argc) {
+            profileFolded = argv[++i];
+        } else if (arg == "--trace" && i + 1 < argc) {
+            tracePath = argv[++i];
+        } else if (arg == "--replay" && i + 1 < argc) {
+            replayPath = argv[++i];
+        } else if (arg == "--seek" && i + 1 < argc) {
+            seek = std::stoull(argv[++i]);
+        } else if (arg == "--metrics" && i + 1 < argc) {
+            metricsPath = argv[++i];
+        } else if (arg == "--stats") {
+            stats = true;
+        } else if (arg == "--stream") {
+            stream = true;
+        } else if (!filePath && arg.rfind("--", 0) != 0) {
+            filePath = argv[i];
+        } else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
 
-void defaultWriteFn(int var){
-    std::cout << var << "\n";
-}
+    if (batchManifest) {
+        return runBatchMode(batchManifest, batchReport, {engine, batchThreads, stackSize, options});
+    }
 
-int main(int argc, char* argv[]) {
-    if (argc < 2) {
-        std::cerr << "Uso: " << argv[0] << " <caminho_do_arquivo>\n";
+    if (!filePath || (stream && (compileOutput || aotOutput || replayPath || tracePath || profileReport || profileFolded))) {
+        usage(argv[0]);
         return 1;
     }
 
     try {
-        // Passo 1: Ler o arquivo
-        std::string fileContent = readFile(argv[1]);
+        // Passo 1 e 2: ler o arquivo e decodificar as instruções (texto ou binário); com
+        // --stream, o parsing segue em outra thread enquanto a VM já executa
+        std::shared_ptr<const Program> program;
+        std::shared_ptr<StreamingProgram> streamed;
+        if (stream) {
+            streamed = std::make_shared<StreamingProgram>(filePath, options);
+        } else {
+            program = loadProgram(filePath, options);
+        }
 
-        // Passo 2: Fazer o parsing das instruções
-        std::vector<Instruction> instructions = parseInstructions(fileContent);
+        if (options.optimize > 0) {
+            // relatório do otimizador
+            const OptimizationStats& optimized = program->optimizationStats();
+            std::cerr << "otimizador (-O" << options.optimize << "): " << optimized.before << " -> " << optimized.after
+                      << " instruções; " << optimized.removed() << " removidas (" << optimized.labels << " labels, "
+                      << optimized.unreachable << " inalcançáveis), " << optimized.folded << " constantes avaliadas, "
+                      << optimized.threaded << " desvios simplificados, " << optimized.inlined << " chamadas expandidas ("
+                      << optimized.expanded << " instruções acrescentadas)\n";
+        }
 
+        if (compileOutput) {
+            writeBytecode(*program, compileOutput, withNames);
+            return 0;
+        }
+
+        if (aotOutput) {
+            AotOptions aot;
+            aot.stackSize = stackSize;
+            compileAot(*program, aotOutput, aot);
+            return 0;
+        }
 
         // Passo 3: iniciar a VM
-        vm = new VirtualMachine();
-        vm->startVM(instructions);
+        VirtualMachine vm(stackSize);
+        if (streamed) {
+            vm.startVM(streamed);
+        } else {
+            vm.startVM(program);
+        }
+
+        if (replayPath) {
+            // Reexecuta o registro sem ler a entrada; com --seek, mostra o estado na instrução
+            Tracer trace = Tracer::read(replayPath, program);
+            trace.replay(vm, seek, defaultWriteFn, engine);
+            if (seek != UINT64_MAX) {
+                vm.debug();
+            } else if (vm.dispatches != trace.finalInstructions || vm.ip != trace.finalIp || vm.sp != trace.finalSp) {
+                std::cerr << "Aviso: a reexecução terminou em ip " << vm.ip << ", sp " << vm.sp << " após "
+                          << vm.dispatches << " instruções; o registro, em ip " << trace.finalIp << ", sp "
+                          << trace.finalSp << " após " << trace.finalInstructions << "\n";
+            }
+            return 0;
+        }
+
+        Profiler profiler;
+        if (profileReport || profileFolded) {
+            vm.profiler = &profiler;
+        }
+
+        Tracer tracer;
+        if (tracePath) {
+            vm.tracer = &tracer;
+        }
+
+        // Passo 4: executar o programa (com --trace e --metrics, os arquivos são gravados
+        // mesmo se houver erro)
+        try {
+            vm.execute(defaultReadFn, defaultWriteFn, engine);
+        } catch (...) {
+            if (tracePath) tracer.write(tracePath, vm);
+            if (metricsPath) writeProfile(metricsPath, [&](std::ostream& out) { writeMetrics(out, vm, false); });
+            throw;
+        }
+        if (tracePath) {
+            tracer.write(tracePath, vm);
+        }
+        if (metricsPath) {
+            writeProfile(metricsPath, [&](std::ostream& out) { writeMetrics(out, vm, true); });
+        }
+
+        if (profileReport) {
+            writeProfile(profileReport, [&](std::ostream& out) { profiler.writeReport(out, *program); });
+        }
+        if (profileFolded) {
+            writeProfile(profileFolded, [&](std::ostream& out) { profiler.writeFolded(out, *program); });
+        }
 
-        // Passo 4: executar o programa
-        vm->execute(defaultReadFn, defaultWriteFn);
+        if (stats) {
+            const Program& loaded = vm.getProgram();
+            std::cerr << "superinstruções: " << loaded.superinstructionCount() << "\n";
+            std::cerr << "pilha verificada: " << (loaded.stackVerified() ? "sim" : "não");
+            if (loaded.maxStackDepth() >= 0) {
+                std::cerr << " (profundidade máxima " << loaded.maxStackDepth() << ")";
+            }
+            std::cerr << "\n";
+            std::cerr << "despachos: " << vm.dispatches << "\n";
+        }
         
     } catch (const std::exception& ex) {
         std::cerr << "Erro: " << ex.what() << std::endl;
@@ -124,31 +300,83 @@ int main(int argc, char* argv[]) {
 }
 
 
-// FFI functions
+// FFI functions (API antiga, com uma instância global; ver vm_api.hpp para várias instâncias)
+static vm_t* defaultVM() {
+    static vm_t* instance = vm_create();
+    return instance;
+}
+
 extern "C"{
-    void initVM(char* file_path){
-        std::string fileContent = readFile(file_path);
+    // initVM e executeVM retornam 0, ou 1 num erro (mensagem em getVMError); nenhuma
+    // exceção atravessa a interface C
+    int initVM(char* file_path){
+        // Passo 1, 2 e 3: ler o arquivo, decodificar as instruções e reiniciar a VM
+        return vm_load(defaultVM(), file_path);
+    }
 
-        // Passo 2: Fazer o parsing das instruções
-        std::vector<Instruction> instructions = parseInstructions(fileContent);
+    int executeVM(int(*readFn)(), void(*writeFn)(int)){
+        return vm_execute(defaultVM(), readFn, writeFn);
+    }
 
-        vm = new VirtualMachine();
-        vm->startVM(instructions);
+    // E/S em buffers: executa até terminar (0), a entrada acabar (2), a saída encher (3) ou
+    // um erro de execução (1, mensagem em getVMError); inputUsed e outputSize recebem
+    // quantos valores foram consumidos e escritos, também no erro
+    int executeVMBuffered(const int* input, int inputSize, int* inputUsed, int* output, int outputCapacity, int* outputSize){
+        vm_io io = {input, (size_t)inputSize, 0, output, (size_t)outputCapacity, 0, nullptr, nullptr};
+        int status = vm_execute_io(defaultVM(), &io);
+        *inputUsed = (int)io.input_used;
+        *outputSize = (int)io.output_size;
+        return status;
     }
 
-    void executeVM(int(*readFn)(), void(*writeFn)(int)){
-        vm->execute(readFn, writeFn);
+    // Como executeVMBuffered, limitado a maxInstructions instruções e timeoutUs microssegundos
+    // (0: sem limite); retorna 4 quando um dos limites acaba e a próxima chamada continua dali
+    int runVM(const int* input, int inputSize, int* inputUsed, int* output, int outputCapacity, int* outputSize,
+              unsigned long long maxInstructions, unsigned long long timeoutUs){
+        vm_io io = {input, (size_t)inputSize, 0, output, (size_t)outputCapacity, 0, nullptr, nullptr};
+        int status = vm_run(defaultVM(), &io, maxInstructions, timeoutUs);
+        *inputUsed = (int)io.input_used;
+        *outputSize = (int)io.output_size;
+        return status;
+    }
+
+    // Mensagem do último erro ("" se não houve)
+    const char* getVMError(){
+        return vm_last_error(defaultVM());
+    }
+
+    // 0 = tabela, 1 = threaded, 2 = JIT; retorna 0 se o motor não existe neste build
+    int setVMEngine(int id){
+        return vm_set_engine(defaultVM(), id) == VM_OK;
     }
 
     int getVMSp(){
-        return vm->sp;
+        return vm_get_sp(defaultVM());
     }
 
     int getVMIp(){
-        return vm->ip;
+        return vm_get_ip(defaultVM());
     }
 
     int getVMStack(int sp){
-        return vm->stack[sp];
+        return vm_get_stack(defaultVM(), sp);
+    }
+
+    // Pilha inteira sem cópia (length recebe o tamanho)
+    const int* getVMStackView(int* length){
+        size_t size;
+        const int* stack = vm_stack_view(defaultVM(), &size);
+        *length = (int)size;
+        return stack;
+    }
+
+    // Registradores, pilha e faixa alterada desde a última chamada (ver vm_state em vm_api.hpp)
+    void getVMState(vm_state* state){
+        vm_get_state(defaultVM(), state);
+    }
+
+    // Métricas desde o último initVM (ver vm_stats em vm_api.hpp)
+    void getVMStats(vm_stats* stats){
+        vm_get_stats(defaultVM(), stats);
     }
 }
@@ -0,0 +1,80 @@
+#include "mapped_file.hpp"
+#include <fstream>
+#include <stdexcept>
+#include <utility>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile(const std::string& filePath) {
+#ifndef _WIN32
+    int fd = open(filePath.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("Não foi possível abrir o arquivo: " + filePath);
+    }
+
+    struct stat info;
+    if (fstat(fd, &info) != 0) {
+        close(fd);
+        throw std::runtime_error("Não foi possível ler o arquivo: " + filePath);
+    }
+
+    this->length = info.st_size;
+    if (this->length > 0) {
+        void* addr = mmap(nullptr, this->length, PROT_READ, MAP_SHARED, fd, 0);
+        if (addr == MAP_FAILED) {
+            close(fd);
+            throw std::runtime_error("Não foi possível mapear o arquivo: " + filePath);
+        }
+        this->address = static_cast<const char*>(addr);
+        this->mapped = true;
+    }
+    close(fd);
+#else
+    std::ifstream file(filePath, std::ios::binary);
+    if (!file) {
+        throw std::runtime_error("Não foi possível abrir o arquivo: " + filePath);
+    }
+    this->buffer.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    this->address = this->buffer.data();
+    this->length = this->buffer.size();
+#endif
+}
+
+MappedFile::~MappedFile() {
+    this->release();
+}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept {
+    *this = std::move(other);
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept {
+    if (this != &other) {
+        this->release();
+        this->buffer = std::move(other.buffer);
+        this->address = other.mapped ? other.address : this->buffer.data();
+        this->length = other.length;
+        this->mapped = other.mapped;
+        other.address = nullptr;
+        other.length = 0;
+        other.mapped = false;
+    }
+    return *this;
+}
+
+void MappedFile::release() {
+#ifndef _WIN32
+    if (this->mapped) {
+        munmap(const_cast<char*>(this->address), this->length);
+    }
+#endif
+    this->address = nullptr;
+    this->length = 0;
+    this->mapped = false;
+    this->buffer.clear();
+}
@@ -0,0 +1,36 @@
+#ifndef MAPPED_FILE_HPP
+#define MAPPED_FILE_HPP
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Arquivo mapeado em memória somente para leitura (mmap).
+// Vários processos que mapeiam o mesmo arquivo compartilham as páginas do page cache.
+// Em plataformas sem mmap o conteúdo é lido para um buffer próprio.
+class MappedFile {
+public:
+    MappedFile() = default;
+    explicit MappedFile(const std::string& filePath);
+    ~MappedFile();
+
+    MappedFile(MappedFile&& other) noexcept;
+    MappedFile& operator=(MappedFile&& other) noexcept;
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    const char* data() const { return address; }
+    size_t size() const { return length; }
+    std::string_view view() const { return std::string_view(address, length); }
+
+private:
+    void release();
+
+    const char* address = nullptr;
+    size_t length = 0;
+    bool mapped = false;
+    std::vector<char> buffer; // usado quando não há mmap
+};
+
+#endif // MAPPED_FILE_HPP
@@ -2,68 +2,120 @@
 #include "vm.hpp"
 #include <iostream>
 #include <stdexcept>
+#include <unordered_map>
+
+static const char* const opNames[OPCODE_COUNT] = {
+    "", "START", "HLT", "DEBUG", "LDC", "LDV", "ADD", "SUB", "MULT", "DIVI",
+    "INV", "AND", "OR", "NEG", "CME", "CMA", "CEQ", "CDIF", "CMEQ", "CMAQ",
+    "JMP", "JMPF", "ALLOC", "DALLOC", "RD", "PRN", "STR", "CALL", "RETURN",
+    "END",
+    "LDV_LDV_ADD_STR", "LDV_LDV_SUB_STR", "LDV_LDV_MULT_STR",
+    "LDV_LDC_CME_JMPF", "LDV_LDC_CMA_JMPF", "LDV_LDC_CEQ_JMPF",
+    "LDV_LDC_CDIF_JMPF", "LDV_LDC_CMEQ_JMPF", "LDV_LDC_CMAQ_JMPF",
+    "LDV_PRN", "CALL_ALLOC", "DALLOC_RETURN"
+};
+
+const std::array<Operation, OPCODE_COUNT> Operations::operations = [] {
+    std::array<Operation, OPCODE_COUNT> table{};
+    auto set = [&table](OpCode op, Operation fn) { table[static_cast<size_t>(op)] = fn; };
+
+    set(OpCode::NOP, opNOP);
+    set(OpCode::START, opNOP);
+    set(OpCode::HLT, opNOP); // tratado diretamente no laço de execução
+    set(OpCode::DEBUG, opDEBUG);
+    set(OpCode::LDC, opLDC);
+    set(OpCode::LDV, opLDV);
+    set(OpCode::ADD, opADD);
+    set(OpCode::SUB, opSUB);
+    set(OpCode::MULT, opMULT);
+    set(OpCode::DIVI, opDIVI);
+    set(OpCode::INV, opINV);
+    set(OpCode::AND, opAND);
+    set(OpCode::OR, opOR);
+    set(OpCode::NEG, opNEG);
+    set(OpCode::CME, opCME);
+    set(OpCode::CMA, opCMA);
+    set(OpCode::CEQ, opCEQ);
+    set(OpCode::CDIF, opCDIF);
+    set(OpCode::CMEQ, opCMEQ);
+    set(OpCode::CMAQ, opCMAQ);
+    set(OpCode::JMP, opJMP);
+    set(OpCode::JMPF, opJMPF);
+    set(OpCode::ALLOC, opALLOC);
+    set(OpCode::DALLOC, opDALLOC);
+    set(OpCode::RD, opRD);
+    set(OpCode::PRN, opPRN);
+    set(OpCode::STR, opSTR);
+    set(OpCode::CALL, opCALL);
+    set(OpCode::RETURN, opRETURN);
+    set(OpCode::END, opNOP); // nunca despachado: o laço para em ip == tamanho do programa
+    set(OpCode::LDV_LDV_ADD_STR, opLDV_LDV_ADD_STR);
+    set(OpCode::LDV_LDV_SUB_STR, opLDV_LDV_SUB_STR);
+    set(OpCode::LDV_LDV_MULT_STR, opLDV_LDV_MULT_STR);
+    set(OpCode::LDV_LDC_CME_JMPF, opLDV_LDC_CME_JMPF);
+    set(OpCode::LDV_LDC_CMA_JMPF, opLDV_LDC_CMA_JMPF);
+    set(OpCode::LDV_LDC_CEQ_JMPF, opLDV_LDC_CEQ_JMPF);
+    set(OpCode::LDV_LDC_CDIF_JMPF, opLDV_LDC_CDIF_JMPF);
+    set(OpCode::LDV_LDC_CMEQ_JMPF, opLDV_LDC_CMEQ_JMPF);
+    set(OpCode::LDV_LDC_CMAQ_JMPF, opLDV_LDC_CMAQ_JMPF);
+    set(OpCode::LDV_PRN, opLDV_PRN);
+    set(OpCode::CALL_ALLOC, opCALL_ALLOC);
+    set(OpCode::DALLOC_RETURN, opDALLOC_RETURN);
+    return table;
+}();
+
+OpCode Operations::getOpCode(const std::string& name) {
+    if (auto op = findOpCode(name)) {
+        return *op;
+    }
+    throw std::invalid_argument("Operação desconhecida: " + name);
+}
+
+std::optional<OpCode> Operations::findOpCode(std::string_view name) {
+    static const std::unordered_map<std::string_view, OpCode> codes = [] {
+        std::unordered_map<std::string_view, OpCode> map;
+        for (size_t i = 1; i < static_cast<size_t>(OpCode::END); i++) {
+            map[opNames[i]] = static_cast<OpCode>(i);
+        }
+        return map;
+    }();
 
-std::unordered_map<std::string, Operation> Operations::operations;
-
-void Operations::initialize() {
-    operations["LDC"] = reinterpret_cast<Operation>(opLDC);
-    operations["LDV"] = reinterpret_cast<Operation>(opLDV);
-    operations["ADD"] = reinterpret_cast<Operation>(opADD);
-    operations["SUB"] = reinterpret_cast<Operation>(opSUB);
-    operations["MULT"] = reinterpret_cast<Operation>(opMULT);
-    operations["DIVI"] = reinterpret_cast<Operation>(opDIVI);
-    operations["INV"] = reinterpret_cast<Operation>(opINV);
-    operations["AND"] = reinterpret_cast<Operation>(opAND);
-    operations["OR"] = reinterpret_cast<Operation>(opOR);
-    operations["NEG"] = reinterpret_cast<Operation>(opNEG);
-    operations["CME"] = reinterpret_cast<Operation>(opCME);
-    operations["CMA"] = reinterpret_cast<Operation>(opCMA);
-    operations["CEQ"] = reinterpret_cast<Operation>(opCEQ);
-    operations["CDIF"] = reinterpret_cast<Operation>(opCDIF);
-    operations["CMEQ"] = reinterpret_cast<Operation>(opCMEQ);
-    operations["CMAQ"] = reinterpret_cast<Operation>(opCMAQ);
-    operations["JMP"] = reinterpret_cast<Operation>(opJMP);
-    operations["JMPF"] = reinterpret_cast<Operation>(opJMPF);
-    operations["ALLOC"] = reinterpret_cast<Operation>(opALLOC);
-    operations["DALLOC"] = reinterpret_cast<Operation>(opDALLOC);
-    operations["RD"] = reinterpret_cast<Operation>(opRD);
-    operations["PRN"] = reinterpret_cast<Operation>(opPRN);
-    operations["STR"] = reinterpret_cast<Operation>(opSTR);
-    operations["CALL"] = reinterpret_cast<Operation>(opCALL);
-    operations["RETURN"] = reinterpret_cast<Operation>(opRETURN);
-}
-
-Operation Operations::getOperation(const std::string& name) {
-    auto it = operations.find(name);
-    if (it != operations.end()) {
+    auto it = codes.find(name);
+    if (it != codes.end()) {
         return it->second;
     }
-    throw std::invalid_argument("Operação desconhecida: " + name);
+    return std::nullopt;
+}
+
+const char* Operations::getName(OpCode op) {
+    return opNames[static_cast<size_t>(op)];
+}
+
+bool Operations::takesLabel(OpCode op) {
+    return op == OpCode::JMP || op == OpCode::JMPF || op == OpCode::CALL || op == OpCode::CALL_ALLOC;
 }
 
-void Operations::opLDC(VirtualMachine& vm, Operand& op1, Operand& op2) {
+void Operations::opNOP(VirtualMachine& vm, const DecodedInstruction& instr) {
+    // Linha de label: nada a fazer
+}
+
+void Operations::opDEBUG(VirtualMachine& vm, const DecodedInstruction& instr) {
+    vm.debug();
+}
+
+void Operations::opLDC(VirtualMachine& vm, const DecodedInstruction& instr) {
     // Carregar constante
-    if (std::holds_alternative<int>(op1)) {
-        int k = std::get<int>(op1);
-        vm.sp++;
-        vm.stack[vm.sp] = k;
-    } else {
-        throw std::runtime_error("LDC de uma constante inteira");
-    }
+    vm.sp++;
+    vm.stack[vm.sp] = instr.op1;
 }
 
-void Operations::opLDV(VirtualMachine& vm, Operand& op1, Operand& op2) {
+void Operations::opLDV(VirtualMachine& vm, const DecodedInstruction& instr) {
     // Carregar valor de um endereço
-    if (std::holds_alternative<int>(op1)) {
-        int n = std::get<int>(op1);
-        vm.sp++;
-        vm.stack[vm.sp] = vm.stack[n];
-    } else {
-        throw std::runtime_error("LDV precisa de um endereço inteiro");
-    }
+    vm.sp++;
+    vm.stack[vm.sp] = vm.stack[instr.op1];
 }
 
-void Operations::opADD(VirtualMachine& vm, Operand& op1, Operand& op2) {
+void Operations::opADD(VirtualMachine& vm, const DecodedInstruction& instr) {
     // Somar os dois últimos valores da pilha
     if (vm.sp <= vm.start_sp+1) {
         throw std::runtime_error("Valores insuficientes na stack ADD");
@@ -72,7 +124,7 @@ void Operations::opADD(VirtualMachine& vm, Operand& op1, Operand& op2) {
     vm.sp--;
 }
 
-void Operations::opSUB(VirtualMachine& vm, Operand& op1, Operand& op2) {
+void Operations::opSUB(VirtualMachine& vm, const DecodedInstruction& instr) {
     // Subtrair os dois últimos valores da pilha
     if (vm.sp <= vm.start_sp+1) {
         throw std::runtime_error("Valores insuficientes na stack SUB");
@@ -81,7 +133,7 @@ void Operations::opSUB(VirtualMachine& vm, Operand& op1, Operand& op2) {
     vm.sp--;
 }
 
-void Operations::opMULT(VirtualMachine& vm, Operand& op1, Operand& op2) {
+void Operations::opMULT(VirtualMachine& vm, const DecodedInstruction& instr) {
     // Multiplicar os dois últimos valores da pilha
     if (vm.sp <= vm.start_sp+1) {
         throw std::runtime_error("Valores insuficientes na stack MULT");
@@ -90,7 +142,7 @@ void Operations::opMULT(VirtualMachine& vm, Operand& op1, Operand& op2) {
     vm.sp--;
 }
 
-void Operations::opDIVI(VirtualMachine& vm, Operand& op1, Operand& op2) {
+void Operations::opDIVI(VirtualMachine& vm, const DecodedInstruction& instr) {
     // Divisão inteira dos dois últimos valores da pilha
     if (vm.sp <= vm.start_sp+1) {
         throw std::runtime_error("Valores insuficientes na stack DIVI");
@@ -102,12 +154,12 @@ void Operations::opDIVI(VirtualMachine& vm, Operand& op1, Operand& op2) {
     vm.sp--;
 }
 
-void Operations::opINV(VirtualMachine& vm, Operand& op1, Operand& op2) {
+void Operations::opINV(VirtualMachine& vm, const DecodedInstruction& instr) {
     // Inverter sinal do último valor da pilha
     vm.stack[vm.sp] = -vm.stack[vm.sp];
 }
 
-void Operations::opAND(VirtualMachine& vm, Operand& op1, Operand& op2) {
+void Operations::opAND(VirtualMachine& vm, const DecodedInstruction& instr) {
     // Conjunção lógica (considerando 0 como falso, qualquer outro valor como verdadeiro)
     if (vm.sp <= vm.start_sp+1) {
         throw std::runtime_error("Valores insuficientes na stack AND");
@@ -116,7 +168,7 @@ void Operations::opAND(VirtualMachine& vm, Operand& op1, Operand& op2) {
     vm.sp--;
 }
 
-void Operations::opOR(VirtualMachine& vm, Operand& op1, Operand& op2) {
+void Operations::opOR(VirtualMachine& vm, const DecodedInstruction& instr) {
     // Disjunção lógica
     if (vm.sp <= vm.start_sp+1) {
         throw std::runtime_error("Valores insuficientes na stack OR");
@@ -125,12 +177,12 @@ void Operations::opOR(VirtualMachine& vm, Operand& op1, Operand& op2) {
     vm.sp--;
 }
 
-void Operations::opNEG(VirtualMachine& vm, Operand& op1, Operand& op2) {
+void Operations::opNEG(VirtualMachine& vm, const DecodedInstruction& instr) {
     // Negação bit
     vm.stack[vm.sp] = 1 - vm.stack[vm.sp];
 }
 
-void Operations::opCME(VirtualMachine& vm, Operand& op1, Operand& op2) {
+void Operations::opCME(VirtualMachine& vm, const DecodedInstruction& instr) {
     // Comparar menor
     if (vm.sp <= vm.start_sp+1) {
         throw std::runtime_error("Valores insuficientes na stack CME");
@@ -139,7 +191,7 @@ void Operations::opCME(VirtualMachine& vm, Operand& op1, Operand& op2) {
     vm.sp--;
 }
 
-void Operations::opCMA(VirtualMachine& vm, Operand& op1, Operand& op2) {
+void Operations::opCMA(VirtualMachine& vm, const DecodedInstruction& instr) {
     // Comparar maior
     if (vm.sp <= vm.start_sp+1) {
         throw std::runtime_error("Valores insuficientes na stack CMA");
@@ -148,7 +200,7 @@ void Operations::opCMA(VirtualMachine& vm, Operand& op1, Operand& op2) {
     vm.sp--;
 }
 
-void Operations::opCEQ(VirtualMachine& vm, Operand& op1, Operand& op2) {
+void Operations::opCEQ(VirtualMachine& vm, const DecodedInstruction& instr) {
     // Comparar igualdade
     if (vm.sp <= vm.start_sp+1) {
         throw std::runtime_error("Valores insuficientes na stack CEQ");
@@ -157,7 +209,7 @@ void Operations::opCEQ(VirtualMachine& vm, Operand& op1, Operand& op2) {
     vm.sp--;
 }
 
-void Operations::opCDIF(VirtualMachine& vm, Operand& op1, Operand& op2) {
+void Operations::opCDIF(VirtualMachine& vm, const DecodedInstruction& instr) {
     // Comparar desigualdade
     if (vm.sp <= vm.start_sp+1) {
         throw std::runtime_error("Valores insuficientes na stack CDIF");
@@ -166,7 +218,7 @@ void Operations::opCDIF(VirtualMachine& vm, Operand& op1, Operand& op2) {
     vm.sp--;
 }
 
-void Operations::opCMEQ(VirtualMachine& vm, Operand& op1, Operand& op2) {
+void Operations::opCMEQ(VirtualMachine& vm, const DecodedInstruction& instr) {
     // Comparar menor ou igual
     if (vm.sp <= vm.start_sp+1) {
         throw std::runtime_error("Valores insuficientes na stack CMEQ");
@@ -175,7 +227,7 @@ void Operations::opCMEQ(VirtualMachine& vm, Operand& op1, Operand& op2) {
     vm.sp--;
 }
 
-void Operations::opCMAQ(VirtualMachine& vm, Operand& op1, Operand& op2) {
+void Operations::opCMAQ(VirtualMachine& vm, const DecodedInstruction& instr) {
     // Comparar maior ou igual
     if (vm.sp <= vm.start_sp+1) {
         throw std::runtime_error("Valores insuficientes na stack CMAQ");
@@ -185,51 +237,39 @@ void Operations::opCMAQ(VirtualMachine& vm, Operand& op1, Operand& op2) {
 }
 
 
-void Operations::opJMP(VirtualMachine& vm, Operand& op1, Operand& op2) {
-    // Desviar sempre para o endereço especificado
-    if (std::holds_alternative<std::string>(op1)) {
-        std::string label = std::get<std::string>(op1);
-        int p = vm.label_cache[label];
-
-        vm.ip = p;
-    } else {
-        throw std::runtime_error("JMP precisa de um label");
-    }
+void Operations::opJMP(VirtualMachine& vm, const DecodedInstruction& instr) {
+    // Desviar sempre para o endereço especificado (resolvido no carregamento)
+    vm.ip = instr.op1;
 }
 
-void Operations::opJMPF(VirtualMachine& vm, Operand& op1, Operand& op2) {
+void Operations::opJMPF(VirtualMachine& vm, const DecodedInstruction& instr) {
     // Desviar se o topo da pilha for falso (0)
-    if (std::holds_alternative<std::string>(op1)) {
-        std::string label = std::get<std::string>(op1);
-        
-        int p = vm.label_cache[label];
 
-        // Verifica se há valores na pilha
-        if (vm.sp <= vm.start_sp) {
-            throw std::runtime_error("Stack esta vazia para o JMPF");
-        }
-        
-        // Se o topo da pilha for 0 (falso), desvia para p
-        if (vm.stack[vm.sp] == 0) {
-            vm.ip = p;
-        } // Caso contrário, nao faça nada - o ip já irá ter sido acrescentado
-                
-        // Reduz o stack pointer
-        vm.sp--;
-    } else {
-        throw std::runtime_error("JMPF precisa de uma label");
+    // Verifica se há valores na pilha
+    if (vm.sp <= vm.start_sp) {
+        throw std::runtime_error("Stack esta vazia para o JMPF");
     }
+
+    // Se o topo da pilha for 0 (falso), desvia para p
+    if (vm.stack[vm.sp] == 0) {
+        vm.ip = instr.op1;
+    } // Caso contrário, nao faça nada - o ip já irá ter sido acrescentado
+
+    // Reduz o stack pointer
+    vm.sp--;
 }
 
 
-void Operations::opALLOC(VirtualMachine& vm, Operand& op1, Operand& op2) {
-    // Verifica se os operandos são inteiros
-    if (!std::holds_alternative<int>(op1) || !std::holds_alternative<int>(op2)) {
-        throw std::runtime_error("ALLOC precisa de 2 argumentos inteiros");
-    }
+void Operations::opALLOC(VirtualMachine& vm, const DecodedInstruction& instr) {
+    int m = instr.op1;  // Endereço base
+    int n = instr.op2;  // Número de elementos a alocar
 
-    int m = std::get<int>(op1);  // Endereço base
-    int n = std::get<int>(op2);  // Número de elementos a alocar
+    // Quadros grandes: cópia em bloco
+    if (n >= BULK_FRAME) {
+        pushFrame(vm.stack.data(), vm.stack.size(), vm.sp, m, n);
+        vm.stats.frameTop(vm.sp);
+        return;
+    }
 
     // Aloca n elementos a partir do endereço m
     for (int k = 0; k < n; k++) {
@@ -239,16 +279,17 @@ void Operations::opALLOC(VirtualMachine& vm, Operand& op1, Operand& op2) {
         // Copia o valor de M[m+k] para o topo da pilha
         vm.stack[vm.sp] = vm.stack[m + k];
     }
+    vm.stats.frameTop(vm.sp);
 }
 
-void Operations::opDALLOC(VirtualMachine& vm, Operand& op1, Operand& op2) {
-    // Verifica se os operandos são inteiros
-    if (!std::holds_alternative<int>(op1) || !std::holds_alternative<int>(op2)) {
-        throw std::runtime_error("DALLOC precisa de 2 argumentos inteiros");
-    }
+void Operations::opDALLOC(VirtualMachine& vm, const DecodedInstruction& instr) {
+    int m = instr.op1;  // Endereço base
+    int n = instr.op2;  // Número de elementos a desalocar
 
-    int m = std::get<int>(op1);  // Endereço base
-    int n = std::get<int>(op2);  // Número de elementos a desalocar
+    // Quadros grandes: cópia em bloco
+    if (n >= BULK_FRAME) {
+        return popFrame(vm.stack.data(), vm.sp, m, n);
+    }
 
     // Desaloca n elementos a partir do endereço m
     for (int k = n - 1; k >= 0; k--) {
@@ -260,46 +301,143 @@ void Operations::opDALLOC(VirtualMachine& vm, Operand& op1, Operand& op2) {
     }
 }
 
-void Operations::opRD(VirtualMachine& vm, Operand& op1, Operand& op2) {
+void Operations::opRD(VirtualMachine& vm, const DecodedInstruction& instr) {
     int var = vm.readFn();
+    if (vm.status != ExecStatus::Running) { // sem entrada: o RD é refeito na próxima execução
+        vm.dispatches--;
+        vm.suspend(vm.ip - 1);
+        return;
+    }
 
     vm.sp++;
     vm.stack[vm.sp] = var;
 }
 
-void Operations::opPRN(VirtualMachine& vm, Operand& op1, Operand& op2) {
+void Operations::opPRN(VirtualMachine& vm, const DecodedInstruction& instr) {
     vm.writeFn(vm.stack[vm.sp]);
+    if (vm.status != ExecStatus::Running) { // saída cheia: o PRN é refeito na próxima execução
+        vm.dispatches--;
+        vm.suspend(vm.ip - 1);
+        return;
+    }
     vm.sp--;
 }
 
-void Operations::opSTR(VirtualMachine& vm, Operand& op1, Operand& op2) {
-    
-    if (!std::holds_alternative<int>(op1)) {
-        throw std::runtime_error("STR precisa de um endereço inteiro");
-    }
-    
-    int n = std::get<int>(op1);
-    vm.stack[n] = vm.stack[vm.sp];;
+void Operations::opSTR(VirtualMachine& vm, const DecodedInstruction& instr) {
+    vm.stack[instr.op1] = vm.stack[vm.sp];
     vm.sp--;
 }
 
-void Operations::opCALL(VirtualMachine& vm, Operand& op1, Operand& op2) {
-    if (std::holds_alternative<std::string>(op1)) {
-        std::string label = std::get<std::string>(op1);
-        
-        int p = vm.label_cache[label];
-        vm.sp++;
+void Operations::opCALL(VirtualMachine& vm, const DecodedInstruction& instr) {
+    vm.sp++;
 
-        vm.stack[vm.sp] = vm.ip; // (ip++ ja foi feito)
-        
-        vm.ip = p;
+    vm.stack[vm.sp] = vm.ip; // (ip++ ja foi feito)
 
-    } else {
-        throw std::runtime_error("CALL precisa de uma label");
-    }
+    vm.ip = instr.op1;
+    vm.stats.enterCall();
+    vm.stats.frameTop(vm.sp);
 }
 
-void Operations::opRETURN(VirtualMachine& vm, Operand& op1, Operand& op2) {
+void Operations::opRETURN(VirtualMachine& vm, const DecodedInstruction& instr) {
     vm.ip = vm.stack[vm.sp];
     vm.sp--;
-}
\ No newline at end of file
+    vm.stats.callDepth--;
+}
+
+// Superinstruções: reproduzem exatamente as escritas da sequência original na pilha,
+// inclusive nas posições acima do topo, que o programa pode ler depois (ALLOC, LDV).
+// Se a sequência original falharia por falta de valores, executa só o LDV inicial e
+// segue pelas instruções originais, que continuam no programa logo depois.
+
+// LDV a; LDV b; <op>; STR c
+template <typename Op>
+static void fusedArith(VirtualMachine& vm, const DecodedInstruction& instr, Op op, Operation ldv) {
+    if (vm.sp < vm.start_sp) {
+        ldv(vm, instr);
+        return;
+    }
+    int* top = vm.stack.data() + vm.sp;
+    top[1] = vm.stack[instr.op1];
+    top[2] = vm.stack[(&instr)[1].op1];
+    top[1] = op(top[1], top[2]);
+    vm.stack[(&instr)[3].op1] = top[1];
+    vm.ip += 3;
+}
+
+// LDV x; LDC k; <comparação>; JMPF L
+template <typename Cmp>
+static void fusedCompareJump(VirtualMachine& vm, const DecodedInstruction& instr, Cmp cmp, Operation ldv) {
+    if (vm.sp < vm.start_sp) {
+        ldv(vm, instr);
+        return;
+    }
+    int* top = vm.stack.data() + vm.sp;
+    top[1] = vm.stack[instr.op1];
+    top[2] = (&instr)[1].op1;
+    top[1] = cmp(top[1], top[2]) ? 1 : 0;
+    vm.ip = top[1] == 0 ? (&instr)[3].op1 : vm.ip + 3;
+}
+
+void Operations::opLDV_LDV_ADD_STR(VirtualMachine& vm, const DecodedInstruction& instr) {
+    fusedArith(vm, instr, [](int a, int b) { return a + b; }, opLDV);
+}
+
+void Operations::opLDV_LDV_SUB_STR(VirtualMachine& vm, const DecodedInstruction& instr) {
+    fusedArith(vm, instr, [](int a, int b) { return a - b; }, opLDV);
+}
+
+void Operations::opLDV_LDV_MULT_STR(VirtualMachine& vm, const DecodedInstruction& instr) {
+    fusedArith(vm, instr, [](int a, int b) { return a * b; }, opLDV);
+}
+
+void Operations::opLDV_LDC_CME_JMPF(VirtualMachine& vm, const DecodedInstruction& instr) {
+    fusedCompareJump(vm, instr, [](int a, int b) { return a < b; }, opLDV);
+}
+
+void Operations::opLDV_LDC_CMA_JMPF(VirtualMachine& vm, const DecodedInstruction& instr) {
+    fusedCompareJump(vm, instr, [](int a, int b) { return a > b; }, opLDV);
+}
+
+void Operations::opLDV_LDC_CEQ_JMPF(VirtualMachine& vm, const DecodedInstruction& instr) {
+    fusedCompareJump(vm, instr, [](int a, int b) { return a == b; }, opLDV);
+}
+
+void Operations::opLDV_LDC_CDIF_JMPF(VirtualMachine& vm, const DecodedInstruction& instr) {
+    fusedCompareJump(vm, instr, [](int a, int b) { return a != b; }, opLDV);
+}
+
+void Operations::opLDV_LDC_CMEQ_JMPF(VirtualMachine& vm, const DecodedInstruction& instr) {
+    fusedCompareJump(vm, instr, [](int a, int b) { return a <= b; }, opLDV);
+}
+
+void Operations::opLDV_LDC_CMAQ_JMPF(VirtualMachine& vm, const DecodedInstruction& instr) {
+    fusedCompareJump(vm, instr, [](int a, int b) { return a >= b; }, opLDV);
+}
+
+void Operations::opLDV_PRN(VirtualMachine& vm, const DecodedInstruction& instr) {
+    // LDV n; PRN (durante o writeFn, ip/sp são os que o PRN original veria)
+    vm.sp++;
+    vm.stack[vm.sp] = vm.stack[instr.op1];
+    vm.ip++;
+    vm.writeFn(vm.stack[vm.sp]);
+    if (vm.status != ExecStatus::Running) { // o LDV já executou; a execução volta no PRN,
+        vm.dispatches--;                      // que conta a sequência ao ser refeito
+        vm.suspend(vm.ip - 1);
+        return;
+    }
+    vm.sp--;
+}
+
+void Operations::opCALL_ALLOC(VirtualMachine& vm, const DecodedInstruction& instr) {
+    // CALL L seguido do ALLOC que inicia o procedimento (a instrução em L)
+    const DecodedInstruction& alloc = vm.getProgram().code()[instr.op1];
+    opCALL(vm, instr);
+    opALLOC(vm, alloc);
+    vm.ip++;
+}
+
+void Operations::opDALLOC_RETURN(VirtualMachine& vm, const DecodedInstruction& instr) {
+    // DALLOC m,n; RETURN
+    opDALLOC(vm, instr);
+    opRETURN(vm, instr);
+}
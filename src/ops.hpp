@@ -1,52 +1,137 @@
 #ifndef OPS_HPP
 #define OPS_HPP
 
+#include <array>
+#include <cstdint>
+#include <optional>
 #include <string>
-#include <stack>
-#include <unordered_map>
-#include <variant>
+#include <string_view>
 
 class VirtualMachine;
 
-using Operand = std::variant<int, std::string>;
+// Códigos das operações suportadas (NOP representa uma linha de label).
+// Os valores fazem parte do formato binário (bytecode.hpp): novos códigos só no final.
+enum class OpCode : int32_t {
+    NOP,
+    START,
+    HLT,
+    DEBUG,
+    LDC,
+    LDV,
+    ADD,
+    SUB,
+    MULT,
+    DIVI,
+    INV,
+    AND,
+    OR,
+    NEG,
+    CME,
+    CMA,
+    CEQ,
+    CDIF,
+    CMEQ,
+    CMAQ,
+    JMP,
+    JMPF,
+    ALLOC,
+    DALLOC,
+    RD,
+    PRN,
+    STR,
+    CALL,
+    RETURN,
+    END,    // terminador ao final de todo programa carregado (não aparece no texto)
 
-typedef void (*Operation)(VirtualMachine &vm, const Operand &op1, const Operand &op2);
+    // Superinstruções (peephole.hpp): substituem só o opcode da primeira instrução da
+    // sequência e leem os demais operandos das instruções seguintes, que ficam intactas
+    LDV_LDV_ADD_STR,
+    LDV_LDV_SUB_STR,
+    LDV_LDV_MULT_STR,
+    LDV_LDC_CME_JMPF,
+    LDV_LDC_CMA_JMPF,
+    LDV_LDC_CEQ_JMPF,
+    LDV_LDC_CDIF_JMPF,
+    LDV_LDC_CMEQ_JMPF,
+    LDV_LDC_CMAQ_JMPF,
+    LDV_PRN,
+    CALL_ALLOC,
+    DALLOC_RETURN,
+    COUNT
+};
+
+constexpr size_t OPCODE_COUNT = static_cast<size_t>(OpCode::COUNT);
+
+// Instrução já decodificada: operandos inteiros e labels resolvidos para endereços
+struct DecodedInstruction {
+    OpCode opcode;
+    int32_t op1;
+    int32_t op2;
+};
+static_assert(sizeof(DecodedInstruction) == 12, "layout usado diretamente pelo formato binário");
+
+typedef void (*Operation)(VirtualMachine &vm, const DecodedInstruction &instr);
 
 class Operations
 {
 public:
-    static void initialize();
-    static Operation getOperation(const std::string &name);
+    // Tradução nome -> código, usada apenas no carregamento do programa
+    static OpCode getOpCode(const std::string &name);
+    static std::optional<OpCode> findOpCode(std::string_view name);
+    static const char* getName(OpCode op);
+
+    // Operações cujo operando é um label (JMP, JMPF, CALL e CALL_ALLOC)
+    static bool takesLabel(OpCode op);
+
+    static Operation getOperation(OpCode op) {
+        return operations[static_cast<size_t>(op)];
+    }
 
 private:
-    static std::unordered_map<std::string, Operation> operations;
+    static const std::array<Operation, OPCODE_COUNT> operations;
 
     // Declaração das operações suportadas
-    static void opLDC(VirtualMachine &vm, Operand& op1, Operand& op2);
-    static void opLDV(VirtualMachine &vm, Operand& op1, Operand& op2);
-    static void opADD(VirtualMachine &vm, Operand& op1, Operand& op2);
-    static void opSUB(VirtualMachine &vm, Operand& op1, Operand& op2);
-    static void opMULT(VirtualMachine &vm, Operand& op1, Operand& op2);
-    static void opDIVI(VirtualMachine &vm, Operand& op1, Operand& op2);
-    static void opINV(VirtualMachine &vm, Operand& op1, Operand& op2);
-    static void opAND(VirtualMachine &vm, Operand& op1, Operand& op2);
-    static void opOR(VirtualMachine &vm, Operand& op1, Operand& op2);
-    static void opNEG(VirtualMachine &vm, Operand& op1, Operand& op2);
-    static void opCME(VirtualMachine &vm, Operand& op1, Operand& op2);
-    static void opCMA(VirtualMachine &vm, Operand& op1, Operand& op2);
-    static void opCEQ(VirtualMachine &vm, Operand& op1, Operand& op2);
-    static void opCDIF(VirtualMachine &vm, Operand& op1, Operand& op2);
-    static void opCMEQ(VirtualMachine &vm, Operand& op1, Operand& op2);
-    static void opCMAQ(VirtualMachine &vm, Operand& op1, Operand& op2);
-    static void opJMP(VirtualMachine& vm, Operand& op1, Operand& op2);
-    static void opJMPF(VirtualMachine& vm, Operand& op1, Operand& op2);
-    static void opALLOC(VirtualMachine& vm, Operand& op1, Operand& op2);
-    static void opDALLOC(VirtualMachine& vm, Operand& op1, Operand& op2);
-    static void opRD(VirtualMachine& vm, Operand& op1, Operand& op2);
-    static void opPRN(VirtualMachine& vm, Operand& op1, Operand& op2);
-    static void opSTR(VirtualMachine& vm, Operand& op1, Operand& op2);
-    static void opCALL(VirtualMachine& vm, Operand& op1, Operand& op2);
-    static void opRETURN(VirtualMachine& vm, Operand& op1, Operand& op2);
+    static void opNOP(VirtualMachine &vm, const DecodedInstruction &instr);
+    static void opDEBUG(VirtualMachine &vm, const DecodedInstruction &instr);
+    static void opLDC(VirtualMachine &vm, const DecodedInstruction &instr);
+    static void opLDV(VirtualMachine &vm, const DecodedInstruction &instr);
+    static void opADD(VirtualMachine &vm, const DecodedInstruction &instr);
+    static void opSUB(VirtualMachine &vm, const DecodedInstruction &instr);
+    static void opMULT(VirtualMachine &vm, const DecodedInstruction &instr);
+    static void opDIVI(VirtualMachine &vm, const DecodedInstruction &instr);
+    static void opINV(VirtualMachine &vm, const DecodedInstruction &instr);
+    static void opAND(VirtualMachine &vm, const DecodedInstruction &instr);
+    static void opOR(VirtualMachine &vm, const DecodedInstruction &instr);
+    static void opNEG(VirtualMachine &vm, const DecodedInstruction &instr);
+    static void opCME(VirtualMachine &vm, const DecodedInstruction &instr);
+    static void opCMA(VirtualMachine &vm, const DecodedInstruction &instr);
+    static void opCEQ(VirtualMachine &vm, const DecodedInstruction &instr);
+    static void opCDIF(VirtualMachine &vm, const DecodedInstruction &instr);
+    static void opCMEQ(VirtualMachine &vm, const DecodedInstruction &instr);
+    static void opCMAQ(VirtualMachine &vm, const DecodedInstruction &instr);
+    static void opJMP(VirtualMachine& vm, const DecodedInstruction &instr);
+    static void opJMPF(VirtualMachine& vm, const DecodedInstruction &instr);
+    static void opALLOC(VirtualMachine& vm, const DecodedInstruction &instr);
+    static void opDALLOC(VirtualMachine& vm, const DecodedInstruction &instr);
+    static void opRD(VirtualMachine& vm, const DecodedInstruction &instr);
+    static void opPRN(VirtualMachine& vm, const DecodedInstruction &instr);
+    static void opSTR(VirtualMachine& vm, const DecodedInstruction &instr);
+    static void opCALL(VirtualMachine& vm, const DecodedInstruction &instr);
+    static void opRETURN(VirtualMachine& vm, const DecodedInstruction &instr);
+
+    // Superinstruções
+    static void opLDV_LDV_ADD_STR(VirtualMachine& vm, const DecodedInstruction &instr);
+    static void opLDV_LDV_SUB_STR(VirtualMachine& vm, const DecodedInstruction &instr);
+    static void opLDV_LDV_MULT_STR(VirtualMachine& vm, const DecodedInstruction &instr);
+    static void opLDV_LDC_CME_JMPF(VirtualMachine& vm, const DecodedInstruction &instr);
+    static void opLDV_LDC_CMA_JMPF(VirtualMachine& vm, const DecodedInstruction &instr);
+    static void opLDV_LDC_CEQ_JMPF(VirtualMachine& vm, const DecodedInstruction &instr);
+    static void opLDV_LDC_CDIF_JMPF(VirtualMachine& vm, const DecodedInstruction &instr);
+    static void opLDV_LDC_CMEQ_JMPF(VirtualMachine& vm, const DecodedInstruction &instr);
+    static void opLDV_LDC_CMAQ_JMPF(VirtualMachine& vm, const DecodedInstruction &instr);
+    static void opLDV_PRN(VirtualMachine& vm, const DecodedInstruction &instr);
+    static void opCALL_ALLOC(VirtualMachine& vm, const DecodedInstruction &instr);
+    static void opDALLOC_RETURN(VirtualMachine& vm, const DecodedInstruction &instr);
 };
 
-#endif
\ No newline at end of file
+#endif
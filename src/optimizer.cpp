@@ -0,0 +1,392 @@
+#include "optimizer.hpp"
+#include <algorithm>
+#include <climits>
+#include <optional>
+
+namespace {
+
+struct Node {
+    DecodedInstruction instr;
+    bool returnAddress = false; // LDC que ocupa o lugar do endereço de retorno (op1 é um endereço)
+};
+
+using Code = std::vector<Node>;
+
+// Operandos que são endereços do programa e mudam com a renumeração
+bool hasTarget(const Node& node) {
+    return Operations::takesLabel(node.instr.opcode) || node.returnAddress;
+}
+
+// Pontos em que a execução pode chegar sem ser pela instrução anterior
+std::vector<bool> findLeaders(const Code& code) {
+    const size_t size = code.size();
+    std::vector<bool> leader(size + 1, false);
+    leader[0] = true;
+    for (size_t i = 0; i < size; i++) {
+        const DecodedInstruction& instr = code[i].instr;
+        if (Operations::takesLabel(instr.opcode)) {
+            leader[std::min<size_t>((uint32_t)instr.op1, size)] = true;
+        }
+        if (instr.opcode == OpCode::CALL || instr.opcode == OpCode::HLT) {
+            leader[i + 1] = true;
+        }
+    }
+    return leader;
+}
+
+// Avaliação de <operação> sobre duas constantes, como a VM faria (nullopt se daria erro)
+std::optional<int32_t> evaluate(OpCode op, int32_t a, int32_t b) {
+    auto wrap = [](int64_t value) { return (int32_t)(uint32_t)value; };
+    switch (op) {
+        case OpCode::ADD: return wrap((int64_t)a + b);
+        case OpCode::SUB: return wrap((int64_t)a - b);
+        case OpCode::MULT: return wrap((int64_t)a * b);
+        case OpCode::DIVI:
+            if (b == 0 || (a == INT32_MIN && b == -1)) return std::nullopt;
+            return a / b;
+        case OpCode::AND: return a == 1 && b == 1 ? 1 : 0;
+        case OpCode::OR: return a == 1 || b == 1 ? 1 : 0;
+        case OpCode::CME: return a < b ? 1 : 0;
+        case OpCode::CMA: return a > b ? 1 : 0;
+        case OpCode::CEQ: return a == b ? 1 : 0;
+        case OpCode::CDIF: return a != b ? 1 : 0;
+        case OpCode::CMEQ: return a <= b ? 1 : 0;
+        case OpCode::CMAQ: return a >= b ? 1 : 0;
+        default: return std::nullopt;
+    }
+}
+
+class Optimizer {
+public:
+    Optimizer(const std::vector<DecodedInstruction>& code, OptimizationStats& stats) : stats(stats) {
+        // o END final não faz parte do código otimizado (é o endereço code.size())
+        for (size_t i = 0; i + 1 < code.size(); i++) {
+            this->code.push_back({code[i]});
+        }
+        this->origin.resize(code.size());
+        for (size_t i = 0; i < code.size(); i++) {
+            this->origin[i] = (int)i;
+        }
+    }
+
+    void run(int level) {
+        std::vector<bool> remove(this->code.size(), false);
+        for (size_t i = 0; i < this->code.size(); i++) {
+            if (this->code[i].instr.opcode == OpCode::NOP) {
+                remove[i] = true;
+                this->stats.labels++;
+            }
+        }
+        this->compact(remove);
+        this->simplify();
+
+        if (level >= 2) {
+            const size_t limit = 4 * this->code.size() + MAX_INLINE_SIZE;
+            for (int round = 0; round < 4 && this->code.size() < limit && this->inlineLeaves(); round++) {
+                this->simplify();
+            }
+        }
+    }
+
+    void write(std::vector<DecodedInstruction>& out, std::vector<int>* addressMap) const {
+        out.clear();
+        out.reserve(this->code.size() + 1);
+        for (const Node& node : this->code) {
+            out.push_back(node.instr);
+        }
+        out.push_back({OpCode::END, 0, 0});
+        if (addressMap) {
+            *addressMap = this->origin;
+        }
+    }
+
+private:
+    Code code;
+    OptimizationStats& stats;
+    std::vector<int> origin; // endereço original -> atual (-1 se removido)
+
+    // Remove as instruções marcadas. Um desvio para uma instrução removida passa a ir para a
+    // próxima mantida: as passadas só removem instruções que não são destino de desvios, ou
+    // que equivalem a seguir para a próxima (labels, JMP para a seguinte, LDC k; JMPF com k != 0)
+    void compact(const std::vector<bool>& remove) {
+        const size_t size = this->code.size();
+        std::vector<int> next(size + 1);
+        int position = 0;
+        for (size_t i = 0; i < size; i++) {
+            next[i] = position;
+            if (!remove[i]) position++;
+        }
+        next[size] = position;
+
+        Code result;
+        result.reserve(position);
+        for (size_t i = 0; i < size; i++) {
+            if (remove[i]) continue;
+            Node node = this->code[i];
+            if (hasTarget(node)) {
+                node.instr.op1 = next[std::min<size_t>((uint32_t)node.instr.op1, size)];
+            }
+            result.push_back(node);
+        }
+        this->code = std::move(result);
+
+        for (int& address : this->origin) {
+            if (address >= 0) {
+                address = (size_t)address < size && remove[address] ? -1 : next[address];
+            }
+        }
+    }
+
+    // Aplica as passadas do nível 1 até não haver mais mudanças
+    void simplify() {
+        while (this->fold() | this->thread() | this->removeUnreachable()) {
+        }
+    }
+
+    bool fold() {
+        const size_t size = this->code.size();
+        const std::vector<bool> leader = findLeaders(this->code);
+        std::vector<bool> remove(size, false);
+        bool changed = false;
+
+        // sequência [i, i + length) dentro de um bloco: só o primeiro pode ser destino de desvio
+        auto inBlock = [&](size_t i, size_t length) {
+            if (i + length > size) return false;
+            for (size_t k = i + 1; k < i + length; k++) {
+                if (leader[k]) return false;
+            }
+            return true;
+        };
+        auto constant = [&](size_t i) {
+            return this->code[i].instr.opcode == OpCode::LDC && !this->code[i].returnAddress;
+        };
+
+        for (size_t i = 0; i < size; i++) {
+            if (!constant(i) || !inBlock(i, 2)) continue;
+            DecodedInstruction& first = this->code[i].instr;
+            const DecodedInstruction& second = this->code[i + 1].instr;
+
+            if (second.opcode == OpCode::INV || second.opcode == OpCode::NEG) {
+                first.op1 = (int32_t)(uint32_t)(second.opcode == OpCode::INV ? -(int64_t)first.op1 : 1 - (int64_t)first.op1);
+                remove[i + 1] = true;
+                i += 1;
+            } else if (second.opcode == OpCode::JMPF) {
+                // desvio decidido na carga: com 0 vira JMP; senão some e a execução segue em i + 2
+                if (first.op1 == 0) {
+                    first = {OpCode::JMP, second.op1, 0};
+                } else {
+                    remove[i] = true;
+                }
+                remove[i + 1] = true;
+                i += 1;
+            } else if (constant(i + 1) && inBlock(i, 3)) {
+                auto value = evaluate(this->code[i + 2].instr.opcode, first.op1, second.op1);
+                if (!value) continue;
+                first.op1 = *value;
+                remove[i + 1] = remove[i + 2] = true;
+                i += 2;
+            } else {
+                continue;
+            }
+            this->stats.folded++;
+            changed = true;
+        }
+
+        if (changed) this->compact(remove);
+        return changed;
+    }
+
+    bool thread() {
+        const size_t size = this->code.size();
+        std::vector<bool> remove(size, false);
+        bool changed = false;
+
+        for (size_t i = 0; i < size; i++) {
+            DecodedInstruction& instr = this->code[i].instr;
+            if (!Operations::takesLabel(instr.opcode)) continue;
+
+            // segue a cadeia de JMPs (no máximo size passos: um laço de JMPs fica como está)
+            uint32_t target = instr.op1;
+            for (size_t steps = 0; target < size && this->code[target].instr.opcode == OpCode::JMP && steps < size; steps++) {
+                target = this->code[target].instr.op1;
+            }
+            if (target != (uint32_t)instr.op1) {
+                instr.op1 = target;
+                this->stats.threaded++;
+                changed = true;
+            }
+
+            if (instr.opcode == OpCode::JMP) {
+                if (target < size && this->code[target].instr.opcode == OpCode::RETURN) {
+                    instr = {OpCode::RETURN, 0, 0};
+                    this->stats.threaded++;
+                    changed = true;
+                } else if (target == i + 1) {
+                    remove[i] = true;
+                    this->stats.threaded++;
+                    changed = true;
+                }
+            }
+        }
+
+        if (changed) this->compact(remove);
+        return changed;
+    }
+
+    bool removeUnreachable() {
+        const size_t size = this->code.size();
+        if (size == 0) return false;
+        std::vector<bool> reached(size + 1, false);
+        std::vector<size_t> pending{0};
+
+        auto reach = [&](size_t address) {
+            if (address < size && !reached[address]) {
+                reached[address] = true;
+                pending.push_back(address);
+            }
+        };
+        reached[0] = true;
+        while (!pending.empty()) {
+            const size_t i = pending.back();
+            pending.pop_back();
+            const DecodedInstruction& instr = this->code[i].instr;
+            switch (instr.opcode) {
+                case OpCode::JMP:
+                    reach((uint32_t)instr.op1);
+                    break;
+                case OpCode::JMPF:
+                case OpCode::CALL:
+                    reach((uint32_t)instr.op1);
+                    reach(i + 1);
+                    break;
+                case OpCode::RETURN:
+                    break; // os retornos possíveis são os i + 1 dos CALLs
+                default:
+                    reach(i + 1); // inclusive depois de HLT
+                    break;
+            }
+        }
+
+        std::vector<bool> remove(size, false);
+        bool changed = false;
+        for (size_t i = 0; i < size; i++) {
+            if (!reached[i]) {
+                remove[i] = true;
+                this->stats.unreachable++;
+                changed = true;
+            }
+        }
+
+        if (changed) this->compact(remove);
+        return changed;
+    }
+
+    // Fim do procedimento que começa em entry (o RETURN), se ele puder ser expandido
+    std::optional<size_t> inlinableBody(size_t entry) const {
+        const size_t size = this->code.size();
+        for (size_t i = entry; i < size && i - entry < MAX_INLINE_SIZE; i++) {
+            const DecodedInstruction& instr = this->code[i].instr;
+            if (instr.opcode == OpCode::RETURN) {
+                // desvios do corpo só para dentro dele
+                for (size_t k = entry; k < i; k++) {
+                    const DecodedInstruction& inner = this->code[k].instr;
+                    if ((inner.opcode == OpCode::JMP || inner.opcode == OpCode::JMPF)
+                        && ((uint32_t)inner.op1 < entry || (uint32_t)inner.op1 > i)) {
+                        return std::nullopt;
+                    }
+                }
+                return i;
+            }
+            if (instr.opcode == OpCode::CALL) {
+                return std::nullopt; // só folhas (e portanto sem recursão)
+            }
+        }
+        return std::nullopt;
+    }
+
+    bool inlineLeaves() {
+        const size_t size = this->code.size();
+        std::vector<std::optional<size_t>> bodyEnd(size);
+        std::vector<bool> checked(size, false);
+
+        Code result;
+        std::vector<bool> resolved; // desvios já com o endereço novo (cópias dos corpos)
+        std::vector<int> position(size + 1);
+        size_t inlined = 0;
+
+        for (size_t i = 0; i < size; i++) {
+            position[i] = result.size();
+            const Node& node = this->code[i];
+            const uint32_t entry = node.instr.op1;
+
+            if (node.instr.opcode == OpCode::CALL && entry < size) {
+                if (!checked[entry]) {
+                    bodyEnd[entry] = this->inlinableBody(entry);
+                    checked[entry] = true;
+                }
+                if (bodyEnd[entry]) {
+                    // LDC <retorno>; corpo; JMPF <retorno> (o RETURN só desempilha)
+                    const size_t end = *bodyEnd[entry];
+                    const int base = result.size() + 1;
+                    const int after = base + (end - entry) + 1;
+                    result.push_back({{OpCode::LDC, after, 0}, true});
+                    resolved.push_back(true);
+                    for (size_t k = entry; k < end; k++) {
+                        // os endereços do corpo apontam para dentro dele (inclusive os
+                        // de expansões feitas nele em rodadas anteriores)
+                        Node copy = this->code[k];
+                        if (hasTarget(copy)) {
+                            copy.instr.op1 = base + (copy.instr.op1 - (int)entry);
+                        }
+                        result.push_back(copy);
+                        resolved.push_back(hasTarget(copy));
+                    }
+                    result.push_back({{OpCode::JMPF, after, 0}});
+                    resolved.push_back(true);
+                    this->stats.expanded += end - entry + 1;
+                    inlined++;
+                    continue;
+                }
+            }
+            result.push_back(node);
+            resolved.push_back(false);
+        }
+        position[size] = result.size();
+
+        if (!inlined) return false;
+
+        for (size_t i = 0; i < result.size(); i++) {
+            if (hasTarget(result[i]) && !resolved[i]) {
+                result[i].instr.op1 = position[std::min<size_t>((uint32_t)result[i].instr.op1, size)];
+            }
+        }
+        for (int& address : this->origin) {
+            if (address >= 0) address = position[address];
+        }
+        this->code = std::move(result);
+        this->stats.inlined += inlined;
+        return true;
+    }
+};
+
+} // namespace
+
+OptimizationStats optimizeCode(std::vector<DecodedInstruction>& code, int level, std::vector<int>* addressMap) {
+    OptimizationStats stats;
+    stats.before = code.empty() ? 0 : code.size() - 1;
+
+    if (level <= 0) {
+        stats.after = stats.before;
+        if (addressMap) {
+            addressMap->resize(code.size());
+            for (size_t i = 0; i < code.size(); i++) (*addressMap)[i] = (int)i;
+        }
+        return stats;
+    }
+
+    Optimizer optimizer(code, stats);
+    optimizer.run(level);
+    optimizer.write(code, addressMap);
+    stats.after = code.size() - 1;
+    return stats;
+}
@@ -0,0 +1,49 @@
+#ifndef OPTIMIZER_HPP
+#define OPTIMIZER_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "ops.hpp"
+
+// Números de uma otimização (optimizeCode)
+struct OptimizationStats {
+    size_t before = 0;      // instruções antes (sem o END)
+    size_t after = 0;       // instruções depois
+    size_t labels = 0;      // linhas de label (NOP) removidas
+    size_t folded = 0;      // sequências com constantes avaliadas na carga
+    size_t threaded = 0;    // desvios redirecionados ou removidos (salto para salto, para a próxima)
+    size_t unreachable = 0; // instruções inalcançáveis removidas
+    size_t inlined = 0;     // chamadas substituídas pelo corpo do procedimento
+    size_t expanded = 0;    // instruções acrescentadas pelas expansões
+
+    size_t removed() const { return before + expanded - after; }
+};
+
+constexpr int MAX_OPTIMIZATION_LEVEL = 2;
+constexpr size_t MAX_INLINE_SIZE = 16;
+
+// Otimizador do programa inteiro, sobre o grafo de controle dado por JMP/JMPF/CALL/RETURN.
+// Recebe as instruções originais (sem superinstruções) terminadas pelo END e as reescreve
+// com os endereços renumerados; addressMap, se não for nulo, recebe para cada endereço
+// antigo (e para o END) o novo, ou -1 se a instrução foi removida.
+//
+// Nível 1: remove as linhas de label; avalia LDC a; LDC b; <operação>, LDC a; INV|NEG e
+// LDC a; JMPF L dentro de um mesmo bloco; redireciona desvios para JMP direto ao destino
+// final (JMP para RETURN vira RETURN) e remove JMP para a instrução seguinte; remove o
+// código inalcançável a partir do START (alvos de desvios e de CALL, retornos de CALL e o
+// que vem depois de HLT, de onde a execução pode continuar).
+// Nível 2: também expande nas chamadas os procedimentos pequenos que não chamam outros
+// (até MAX_INLINE_SIZE instruções, do alvo do CALL até o primeiro RETURN, sem desvios para
+// fora). A expansão mantém a pilha idêntica à da chamada: um LDC ocupa a posição do
+// endereço de retorno, que o ALLOC/DALLOC do procedimento salva e restaura, e o RETURN
+// vira um JMPF para a instrução seguinte, que só a desempilha. Procedimentos que passam
+// a ser folhas depois de uma rodada podem ser expandidos na seguinte.
+//
+// Suposições (as do código gerado pelo compilador): o programa não lê valores deixados
+// acima do topo da pilha por expressões já avaliadas (variáveis não inicializadas) e
+// todo RETURN volta para a instrução depois do CALL que o chamou.
+OptimizationStats optimizeCode(std::vector<DecodedInstruction>& code, int level,
+                               std::vector<int>* addressMap = nullptr);
+
+#endif // OPTIMIZER_HPP
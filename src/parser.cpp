@@ -0,0 +1,153 @@
+#include "parser.hpp"
+#include <charconv>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+int SymbolTable::intern(std::string_view name) {
+    auto [it, inserted] = this->ids.try_emplace(name, (int)this->names.size());
+    if (inserted) {
+        this->names.push_back(name);
+    }
+    return it->second;
+}
+
+// Mesmo critério de espaço em branco do operator>> (isspace no locale "C")
+static inline bool isBlank(char c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
+}
+
+static inline std::string_view nextWord(const char*& p, const char* end) {
+    while (p < end && isBlank(*p)) p++;
+    const char* start = p;
+    while (p < end && !isBlank(*p)) p++;
+    return std::string_view(start, p - start);
+}
+
+static std::string lineError(const std::string& message, size_t line) {
+    return message + " (linha " + std::to_string(line) + ")";
+}
+
+// Converte um operando inteiro com a mesma tolerância de std::stoi (sinal opcional, lixo no final ignorado)
+static int32_t parseInt(std::string_view text, size_t line) {
+    const char* first = text.data();
+    const char* last = text.data() + text.size();
+    if (first < last && *first == '+') first++;
+
+    int32_t value = 0;
+    auto [ptr, ec] = std::from_chars(first, last, value);
+    if (ec == std::errc::result_out_of_range) {
+        throw std::out_of_range(lineError("Operando fora do intervalo: " + std::string(text), line));
+    }
+    if (ec != std::errc()) {
+        throw std::invalid_argument(lineError("Operando inválido: " + std::string(text), line));
+    }
+    return value;
+}
+
+ParsedProgram parseProgram(std::string_view source) {
+    ProgramParser parser(source);
+    parser.parse();
+    ParsedProgram result = std::move(parser.program());
+    resolveLabels(result);
+    return result;
+}
+
+ProgramParser::ProgramParser(std::string_view source)
+    : begin(source.data()), end(source.data() + source.size()), p(source.data()) {
+    // estimativa do número de instruções: uma por quebra de linha
+    size_t lines = 1;
+    for (const char* q = begin; (q = static_cast<const char*>(std::memchr(q, '\n', end - q))); q++) {
+        lines++;
+    }
+    result.code.reserve(lines + 1);
+    result.lineOffsets.reserve(lines);
+}
+
+bool ProgramParser::parse(size_t maxLines) {
+    ParsedProgram& result = this->result;
+    const char* const begin = this->begin;
+    const char* const end = this->end;
+    const char* p = this->p;
+    size_t lineNumber = this->lineNumber;
+
+    for (size_t parsed = 0; p < end && parsed < maxLines; parsed++) {
+        const char* newline = static_cast<const char*>(std::memchr(p, '\n', end - p));
+        const char* lineEnd = newline ? newline : end;
+        lineNumber++;
+
+        if (lineEnd == p) { // Ignora linhas vazias
+            p = lineEnd + 1;
+            continue;
+        }
+
+        result.lineOffsets.push_back(p - begin);
+        const int32_t address = result.code.size();
+
+        const char* cursor = p;
+        std::string_view word1 = nextWord(cursor, lineEnd);
+        std::string_view word2 = nextWord(cursor, lineEnd);
+
+        DecodedInstruction instr{OpCode::NOP, 0, 0};
+
+        if (word2 == "NULL") {
+            // Linha representa um label
+            int id = result.symbols.intern(word1);
+            if (id >= (int)result.labelAddress.size()) {
+                result.labelAddress.resize(id + 1, -1);
+            }
+            result.labelAddress[id] = address;
+        } else if (!word1.empty()) {
+            // Linha representa uma instrução
+            std::optional<OpCode> opcode = Operations::findOpCode(word1);
+            if (!opcode) {
+                throw std::invalid_argument(lineError("Operação desconhecida: " + std::string(word1), lineNumber));
+            }
+            instr.opcode = *opcode;
+
+            std::string_view op1 = word2, op2;
+            const char* comma = static_cast<const char*>(std::memchr(word2.data(), ',', word2.size()));
+            if (comma) {
+                op1 = word2.substr(0, comma - word2.data());
+                op2 = word2.substr(comma - word2.data() + 1);
+            }
+
+            if (Operations::takesLabel(instr.opcode)) {
+                if (word2.empty()) {
+                    throw std::invalid_argument(lineError(std::string(word1) + " precisa de um label", lineNumber));
+                }
+                instr.op1 = result.symbols.intern(op1); // resolvido depois, quando todos os labels forem conhecidos
+            } else {
+                if (!word2.empty()) instr.op1 = parseInt(op1, lineNumber);
+                if (comma) instr.op2 = parseInt(op2, lineNumber);
+            }
+        }
+
+        result.code.push_back(instr);
+        p = lineEnd + 1;
+    }
+
+    this->p = p;
+    this->lineNumber = lineNumber;
+    return p < end;
+}
+
+void resolveLabels(ParsedProgram& result) {
+    // resolve os símbolos; desvios apontam direto para a primeira instrucao apos o(s) label(s)
+    result.labelAddress.resize(result.symbols.size(), -1);
+    const int32_t size = result.code.size();
+    for (auto& instr : result.code) {
+        if (Operations::takesLabel(instr.opcode)) {
+            int32_t target = result.labelAddress[instr.op1];
+            if (target < 0) {
+                throw std::invalid_argument("Label não encontrado: " + std::string(result.symbols.name(instr.op1)));
+            }
+            while (target < size && result.code[target].opcode == OpCode::NOP) {
+                target++;
+            }
+            instr.op1 = target;
+        }
+    }
+
+    result.code.push_back({OpCode::END, 0, 0});
+}
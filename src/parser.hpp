@@ -0,0 +1,59 @@
+#ifndef PARSER_HPP
+#define PARSER_HPP
+
+#include <cstdint>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include "ops.hpp"
+
+// Tabela de símbolos: cada nome de label recebe um id inteiro.
+// Os nomes são views para o texto do programa, que precisa continuar vivo.
+class SymbolTable {
+public:
+    int intern(std::string_view name);
+    std::string_view name(int id) const { return names[id]; }
+    size_t size() const { return names.size(); }
+
+private:
+    std::unordered_map<std::string_view, int> ids;
+    std::vector<std::string_view> names;
+};
+
+// Resultado do parsing: instruções já decodificadas (com END no final) e labels resolvidos
+struct ParsedProgram {
+    std::vector<DecodedInstruction> code;
+    std::vector<uint32_t> lineOffsets; // início da linha de cada instrução no texto
+    SymbolTable symbols;
+    std::vector<int32_t> labelAddress; // por id de símbolo; -1 quando só é referenciado
+};
+
+// Parsing em uma única passada sobre o texto, sem cópias de strings.
+// Aceita o mesmo formato de parseInstructions (espaços no início, CRLF, linhas "label NULL").
+ParsedProgram parseProgram(std::string_view source);
+
+// Parsing incremental (carregamento em fluxo): cada parse() decodifica até maxLines linhas a
+// partir de onde o anterior parou. Os desvios guardam em op1 o id do símbolo do label até
+// resolveLabels. A capacidade de code é reservada no construtor, então as instruções já
+// decodificadas não mudam de lugar.
+class ProgramParser {
+public:
+    explicit ProgramParser(std::string_view source);
+
+    bool parse(size_t maxLines = SIZE_MAX); // false quando o texto acabou
+    const ParsedProgram& program() const { return result; }
+    ParsedProgram& program() { return result; }
+
+private:
+    const char* begin;
+    const char* end;
+    const char* p;
+    size_t lineNumber = 0;
+    ParsedProgram result;
+};
+
+// Resolve os labels depois do parsing completo: os desvios passam a apontar direto para a
+// primeira instrução depois do(s) label(s), e o END é acrescentado
+void resolveLabels(ParsedProgram& program);
+
+#endif // PARSER_HPP
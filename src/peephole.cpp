@@ -0,0 +1,115 @@
+#include "peephole.hpp"
+
+static OpCode fusedArith(OpCode op) {
+    switch (op) {
+        case OpCode::ADD: return OpCode::LDV_LDV_ADD_STR;
+        case OpCode::SUB: return OpCode::LDV_LDV_SUB_STR;
+        case OpCode::MULT: return OpCode::LDV_LDV_MULT_STR;
+        default: return OpCode::NOP;
+    }
+}
+
+static OpCode fusedCompare(OpCode op) {
+    switch (op) {
+        case OpCode::CME: return OpCode::LDV_LDC_CME_JMPF;
+        case OpCode::CMA: return OpCode::LDV_LDC_CMA_JMPF;
+        case OpCode::CEQ: return OpCode::LDV_LDC_CEQ_JMPF;
+        case OpCode::CDIF: return OpCode::LDV_LDC_CDIF_JMPF;
+        case OpCode::CMEQ: return OpCode::LDV_LDC_CMEQ_JMPF;
+        case OpCode::CMAQ: return OpCode::LDV_LDC_CMAQ_JMPF;
+        default: return OpCode::NOP;
+    }
+}
+
+size_t fuseSuperinstructions(std::vector<DecodedInstruction>& code) {
+    size_t fused = 0;
+    // o último elemento é o END, que nunca participa de uma sequência
+    const size_t size = code.empty() ? 0 : code.size() - 1;
+
+    auto at = [&](size_t i) { return i < size ? code[i].opcode : OpCode::END; };
+
+    std::vector<bool> target(size, false);
+    for (size_t i = 0; i < size; i++) {
+        OpCode op = code[i].opcode;
+        if ((op == OpCode::JMP || op == OpCode::JMPF || op == OpCode::CALL) && (uint32_t)code[i].op1 < size) {
+            target[code[i].op1] = true;
+        }
+    }
+    auto entered = [&](size_t i, size_t length) {
+        for (size_t k = i + 1; k < i + length && k < size; k++) {
+            if (target[k]) return true;
+        }
+        return false;
+    };
+
+    for (size_t i = 0; i < size; i++) {
+        OpCode replacement = OpCode::NOP;
+        size_t length = 1;
+        switch (code[i].opcode) {
+            case OpCode::LDV:
+                if (at(i + 1) == OpCode::LDV && fusedArith(at(i + 2)) != OpCode::NOP && at(i + 3) == OpCode::STR) {
+                    replacement = fusedArith(at(i + 2));
+                    length = 4;
+                } else if (at(i + 1) == OpCode::LDC && fusedCompare(at(i + 2)) != OpCode::NOP && at(i + 3) == OpCode::JMPF) {
+                    replacement = fusedCompare(at(i + 2));
+                    length = 4;
+                } else if (at(i + 1) == OpCode::PRN) {
+                    replacement = OpCode::LDV_PRN;
+                    length = 2;
+                }
+                break;
+            case OpCode::CALL:
+                if (at((uint32_t)code[i].op1) == OpCode::ALLOC) {
+                    replacement = OpCode::CALL_ALLOC;
+                }
+                break;
+            case OpCode::DALLOC:
+                if (at(i + 1) == OpCode::RETURN) {
+                    replacement = OpCode::DALLOC_RETURN;
+                    length = 2;
+                }
+                break;
+            default:
+                break;
+        }
+
+        if (replacement != OpCode::NOP && !entered(i, length)) {
+            code[i].opcode = replacement;
+            fused++;
+            i += length - 1;
+        }
+    }
+
+    return fused;
+}
+
+int fusedLength(OpCode op) {
+    switch (op) {
+        case OpCode::LDV_LDV_ADD_STR:
+        case OpCode::LDV_LDV_SUB_STR:
+        case OpCode::LDV_LDV_MULT_STR:
+        case OpCode::LDV_LDC_CME_JMPF:
+        case OpCode::LDV_LDC_CMA_JMPF:
+        case OpCode::LDV_LDC_CEQ_JMPF:
+        case OpCode::LDV_LDC_CDIF_JMPF:
+        case OpCode::LDV_LDC_CMEQ_JMPF:
+        case OpCode::LDV_LDC_CMAQ_JMPF:
+            return 4;
+        case OpCode::LDV_PRN:
+        case OpCode::DALLOC_RETURN:
+            return 2;
+        default:
+            return 1;
+    }
+}
+
+OpCode originalOpcode(OpCode op) {
+    switch (op) {
+        case OpCode::CALL_ALLOC:
+            return OpCode::CALL;
+        case OpCode::DALLOC_RETURN:
+            return OpCode::DALLOC;
+        default:
+            return op >= OpCode::LDV_LDV_ADD_STR && op < OpCode::COUNT ? OpCode::LDV : op;
+    }
+}
@@ -0,0 +1,28 @@
+#ifndef PEEPHOLE_HPP
+#define PEEPHOLE_HPP
+
+#include <cstddef>
+#include <vector>
+#include "ops.hpp"
+
+// Funde as sequências geradas com frequência pelo compilador em superinstruções:
+//   LDV a; LDV b; ADD|SUB|MULT; STR c      -> LDV_LDV_<op>_STR
+//   LDV x; LDC k; CME|CMA|...|CMAQ; JMPF L -> LDV_LDC_<cmp>_JMPF
+//   LDV n; PRN                             -> LDV_PRN
+//   DALLOC m,n; RETURN                     -> DALLOC_RETURN
+//   CALL L, com ALLOC m,n em L             -> CALL_ALLOC (executa também o ALLOC do
+//                                             procedimento e segue na instrução depois dele)
+// Só o opcode da primeira instrução muda; as seguintes continuam no lugar, então
+// endereços e labels seguem válidos sem remapeamento. Uma sequência com alvo de desvio no
+// meio (possível depois que o otimizador remove as linhas de label) não é fundida: entrar
+// nela contaria instruções diferentes em cada motor.
+// Retorna o número de superinstruções criadas.
+size_t fuseSuperinstructions(std::vector<DecodedInstruction>& code);
+
+// Número de instruções originais cobertas pela superinstrução (1 para as demais)
+int fusedLength(OpCode op);
+
+// Instrução original no endereço da superinstrução (a própria instrução para as demais)
+OpCode originalOpcode(OpCode op);
+
+#endif // PEEPHOLE_HPP
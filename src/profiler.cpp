@@ -0,0 +1,178 @@
+#include "profiler.hpp"
+#include <algorithm>
+#include <climits>
+#include <iomanip>
+#include <string>
+#include "program.hpp"
+
+// Procedimento raiz: o programa a partir do START
+static constexpr unsigned MAIN = UINT_MAX;
+
+static double milliseconds(std::chrono::steady_clock::duration d) {
+    return std::chrono::duration<double, std::milli>(d).count();
+}
+
+// Linhas de label não têm mnemônico próprio
+static const char* opName(OpCode op) {
+    return op == OpCode::NOP ? "NOP" : Operations::getName(op);
+}
+
+Profiler::Profiler() {
+    this->nodes.push_back({-1, MAIN});
+    this->push(MAIN, 0);
+}
+
+void Profiler::push(unsigned procedure, int node) {
+    Procedure& proc = this->procedures[procedure];
+    proc.calls++;
+    proc.depth++;
+    this->frames.push_back({node, this->instructions, Clock::now()});
+}
+
+void Profiler::pop() {
+    const Frame frame = this->frames.back();
+    this->frames.pop_back();
+
+    Procedure& proc = this->procedures[this->nodes[frame.node].procedure];
+    const Clock::duration elapsed = Clock::now() - frame.start;
+    proc.exclusiveTime += elapsed - frame.children;
+    if (--proc.depth == 0) {
+        // recursão: só a ativação mais externa soma no inclusivo
+        proc.inclusive += this->instructions - frame.startInstructions;
+        proc.inclusiveTime += elapsed;
+    }
+    if (!this->frames.empty()) {
+        this->frames.back().children += elapsed;
+    }
+}
+
+void Profiler::onCall(unsigned target) {
+    Node& parent = this->nodes[this->frames.back().node];
+    auto it = parent.children.find(target);
+    int node;
+    if (it != parent.children.end()) {
+        node = it->second;
+    } else {
+        node = (int)this->nodes.size();
+        const int parentIndex = this->frames.back().node;
+        this->nodes[parentIndex].children[target] = node;
+        this->nodes.push_back({parentIndex, target});
+    }
+    this->push(target, node);
+}
+
+void Profiler::onReturn() {
+    // RETURN sem CALL correspondente (o principal nunca sai da pilha sombra)
+    if (this->frames.size() > 1) {
+        this->pop();
+    }
+}
+
+void Profiler::closeFrames() {
+    while (!this->frames.empty()) {
+        this->pop();
+    }
+    // a partir daqui, novas instruções voltam a contar no principal
+    this->push(MAIN, 0);
+    this->procedures[MAIN].calls--;
+}
+
+std::string Profiler::procedureName(const Program& program, unsigned procedure) const {
+    if (procedure == MAIN) {
+        return "main";
+    }
+
+    if (this->names.empty()) {
+        // label -> primeira instrução depois dele (o alvo resolvido dos CALLs)
+        const DecodedInstruction* code = program.code();
+        for (const auto& [label, address] : program.labels()) {
+            unsigned target = address;
+            while (target < program.size() && code[target].opcode == OpCode::NOP) target++;
+            auto [it, inserted] = this->names.try_emplace(target, label);
+            if (!inserted && label < it->second) it->second = label;
+        }
+    }
+
+    auto it = this->names.find(procedure);
+    return it != this->names.end() ? it->second : "proc_" + std::to_string(procedure);
+}
+
+void Profiler::writeReport(std::ostream& out, const Program& program) {
+    this->closeFrames();
+
+    auto percent = [&](uint64_t count) {
+        return this->instructions ? 100.0 * count / this->instructions : 0.0;
+    };
+    out << std::fixed << std::setprecision(2);
+    out << "=== Perfil ===\n";
+    out << "instruções: " << this->instructions << "\n";
+
+    out << "\nPor operação:\n";
+    std::vector<size_t> ops;
+    for (size_t op = 0; op < OPCODE_COUNT; op++) {
+        if (this->opcodeCounts[op]) ops.push_back(op);
+    }
+    std::sort(ops.begin(), ops.end(), [&](size_t a, size_t b) { return this->opcodeCounts[a] > this->opcodeCounts[b]; });
+    for (size_t op : ops) {
+        out << "  " << std::left << std::setw(20) << opName(static_cast<OpCode>(op)) << std::right
+            << std::setw(14) << this->opcodeCounts[op] << std::setw(8) << percent(this->opcodeCounts[op]) << "%\n";
+    }
+
+    constexpr size_t TOP_ADDRESSES = 20;
+    out << "\nEndereços mais executados:\n";
+    std::vector<unsigned> addresses;
+    for (unsigned a = 0; a < this->addressCounts.size(); a++) {
+        if (this->addressCounts[a]) addresses.push_back(a);
+    }
+    std::sort(addresses.begin(), addresses.end(), [&](unsigned a, unsigned b) {
+        return this->addressCounts[a] != this->addressCounts[b] ? this->addressCounts[a] > this->addressCounts[b] : a < b;
+    });
+    addresses.resize(std::min(addresses.size(), TOP_ADDRESSES));
+    for (unsigned a : addresses) {
+        const DecodedInstruction& instr = program.code()[a];
+        out << "  " << std::setw(6) << a << std::setw(14) << this->addressCounts[a] << std::setw(8) << percent(this->addressCounts[a]) << "%  "
+            << opName(instr.opcode) << " " << instr.op1 << "," << instr.op2 << "\n";
+    }
+
+    // instruções exclusivas: soma dos nós da árvore de chamadas de cada procedimento
+    std::unordered_map<unsigned, uint64_t> exclusive;
+    for (const Node& node : this->nodes) {
+        exclusive[node.procedure] += node.self;
+    }
+
+    out << "\nProcedimentos:\n";
+    out << "  " << std::left << std::setw(24) << "nome" << std::right << std::setw(10) << "chamadas"
+        << std::setw(16) << "instr. incl." << std::setw(16) << "instr. excl."
+        << std::setw(14) << "ms incl." << std::setw(14) << "ms excl." << "\n";
+    std::vector<unsigned> procs;
+    for (const auto& [procedure, stats] : this->procedures) {
+        procs.push_back(procedure);
+    }
+    std::sort(procs.begin(), procs.end(), [&](unsigned a, unsigned b) {
+        return exclusive[a] != exclusive[b] ? exclusive[a] > exclusive[b] : a < b;
+    });
+    for (unsigned procedure : procs) {
+        const Procedure& stats = this->procedures[procedure];
+        out << "  " << std::left << std::setw(24) << this->procedureName(program, procedure) << std::right
+            << std::setw(10) << stats.calls << std::setw(16) << stats.inclusive << std::setw(16) << exclusive[procedure]
+            << std::setw(14) << milliseconds(stats.inclusiveTime) << std::setw(14) << milliseconds(stats.exclusiveTime) << "\n";
+    }
+}
+
+void Profiler::writeFolded(std::ostream& out, const Program& program) {
+    this->closeFrames();
+
+    for (size_t i = 0; i < this->nodes.size(); i++) {
+        if (!this->nodes[i].self) {
+            continue;
+        }
+        std::vector<std::string> path;
+        for (int n = (int)i; n >= 0; n = this->nodes[n].parent) {
+            path.push_back(this->procedureName(program, this->nodes[n].procedure));
+        }
+        for (size_t k = path.size(); k-- > 0;) {
+            out << path[k] << (k ? ";" : " ");
+        }
+        out << this->nodes[i].self << "\n";
+    }
+}
@@ -0,0 +1,82 @@
+#ifndef PROFILER_HPP
+#define PROFILER_HPP
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <ostream>
+#include <unordered_map>
+#include <vector>
+#include "ops.hpp"
+
+class Program;
+
+// Perfil de execução: instruções por opcode e por endereço e, por procedimento (alvo de
+// CALL), chamadas, instruções e tempo inclusivos/exclusivos, usando uma pilha de chamadas
+// sombra. Só é alimentado pela variante instrumentada do motor de tabela
+// (VirtualMachine::profiler); sem profiler, nenhum motor paga nada.
+class Profiler {
+public:
+    Profiler();
+
+    // Chamados pela VM instrumentada
+    void onInstruction(unsigned address, OpCode op) {
+        this->opcodeCounts[static_cast<size_t>(op)]++;
+        if (address >= this->addressCounts.size()) this->addressCounts.resize(address + 1);
+        this->addressCounts[address]++;
+        this->nodes[this->frames.back().node].self++;
+        this->instructions++;
+    }
+    void onCall(unsigned target);
+    void onReturn();
+
+    uint64_t instructionCount() const { return instructions; }
+
+    // Relatório em texto e pilhas agregadas ("a;b;c N", aceito por flamegraph.pl/speedscope).
+    // Os procedimentos ainda abertos (inclusive o principal) são encerrados antes.
+    void writeReport(std::ostream& out, const Program& program);
+    void writeFolded(std::ostream& out, const Program& program);
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    // Nó da árvore de chamadas (um por caminho distinto de procedimentos)
+    struct Node {
+        int parent;
+        unsigned procedure;
+        uint64_t self = 0; // instruções executadas com este caminho no topo
+        std::map<unsigned, int> children;
+    };
+
+    struct Frame {
+        int node;
+        uint64_t startInstructions;
+        Clock::time_point start;
+        Clock::duration children{};
+    };
+
+    struct Procedure {
+        uint64_t calls = 0;
+        uint64_t inclusive = 0; // instruções (chamadas recursivas contam uma vez)
+        Clock::duration inclusiveTime{};
+        Clock::duration exclusiveTime{};
+        unsigned depth = 0;     // ativações na pilha sombra
+    };
+
+    void push(unsigned procedure, int node);
+    void pop();
+    void closeFrames();
+    std::string procedureName(const Program& program, unsigned procedure) const;
+
+    std::array<uint64_t, OPCODE_COUNT> opcodeCounts{};
+    std::vector<uint64_t> addressCounts;
+    uint64_t instructions = 0;
+
+    std::vector<Node> nodes;
+    std::vector<Frame> frames;
+    std::unordered_map<unsigned, Procedure> procedures;
+    mutable std::unordered_map<unsigned, std::string> names;
+};
+
+#endif // PROFILER_HPP
@@ -0,0 +1,313 @@
+#include "program.hpp"
+#include "bytecode.hpp"
+#include "jit.hpp"
+#include "loader.hpp"
+#include "parser.hpp"
+#include "peephole.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <stdexcept>
+
+Program::Program(const std::vector<Instruction>& instructions) : instructions(instructions) {
+    // cria o label cache (label->endereco)
+    for (int i=0; i<this->instructions.size(); i++){
+        const auto& instr = this->instructions[i];
+
+        if (instr.label){
+            this->label_cache[instr.label.value()] = i;
+        }
+    }
+    this->labelsLoaded = true;
+
+    this->decode();
+    this->scanAddresses();
+    this->verification = verifyStack(this->codePtr, this->codeSize);
+}
+
+// Converte as instruções textuais em {opcode, operandos inteiros}, resolvendo os labels
+void Program::decode() {
+    this->decoded.reserve(this->instructions.size() + 1);
+
+    for (const auto& instr : this->instructions) {
+        DecodedInstruction decoded{OpCode::NOP, 0, 0};
+
+        if (!instr.operation.empty()) {
+            decoded.opcode = Operations::getOpCode(instr.operation);
+
+            if (Operations::takesLabel(decoded.opcode)) {
+                if (!instr.op1) {
+                    throw std::invalid_argument(instr.operation + " precisa de um label");
+                }
+                auto it = this->label_cache.find(instr.op1.value());
+                if (it == this->label_cache.end()) {
+                    throw std::invalid_argument("Label não encontrado: " + instr.op1.value());
+                }
+                decoded.op1 = it->second;
+            } else {
+                if (instr.op1) decoded.op1 = std::stoi(instr.op1.value());
+                if (instr.op2) decoded.op2 = std::stoi(instr.op2.value());
+            }
+        }
+
+        this->decoded.push_back(decoded);
+    }
+
+    // desvios apontam direto para a primeira instrucao apos o(s) label(s)
+    for (auto& decoded : this->decoded) {
+        if (Operations::takesLabel(decoded.opcode)) {
+            while (decoded.op1 < (int)this->decoded.size() && this->decoded[decoded.op1].opcode == OpCode::NOP) {
+                decoded.op1++;
+            }
+        }
+    }
+
+    this->codeSize = this->decoded.size();
+    this->decoded.push_back({OpCode::END, 0, 0});
+    this->codePtr = this->decoded.data();
+}
+
+Program::Program(MappedFile file) : image(std::move(file)) {
+    if (isBytecode(this->image.view())) {
+        this->loadBytecode();
+    } else {
+        this->loadText(parseProgram(this->image.view()));
+    }
+    this->scanAddresses();
+    this->verification = verifyStack(this->codePtr, this->codeSize);
+}
+
+Program::Program(MappedFile file, ParsedProgram parsed) : image(std::move(file)) {
+    this->loadText(std::move(parsed));
+    this->scanAddresses();
+    this->verification = verifyStack(this->codePtr, this->codeSize);
+}
+
+Program::~Program() = default;
+
+void Program::loadText(ParsedProgram parsed) {
+    for (size_t id = 0; id < parsed.symbols.size(); id++) {
+        if (parsed.labelAddress[id] >= 0) {
+            this->label_cache[std::string(parsed.symbols.name(id))] = parsed.labelAddress[id];
+        }
+    }
+    this->labelsLoaded = true;
+
+    this->decoded = std::move(parsed.code);
+    this->lineOffsets = std::move(parsed.lineOffsets);
+    this->codeSize = this->decoded.size() - 1;
+    this->codePtr = this->decoded.data();
+}
+
+void Program::loadBytecode() {
+    const char* data = this->image.data();
+    const size_t fileSize = this->image.size();
+
+    if (fileSize < sizeof(BytecodeHeader)) {
+        throw std::invalid_argument("Arquivo de bytecode inválido");
+    }
+
+    const auto* header = reinterpret_cast<const BytecodeHeader*>(data);
+    if (header->version != BYTECODE_VERSION) {
+        throw std::invalid_argument("Versão de bytecode não suportada: " + std::to_string(header->version));
+    }
+
+    const uint64_t count = header->instructionCount;
+    const uint64_t codeBytes = (count + 1) * sizeof(DecodedInstruction);
+    const uint64_t labelBytes = uint64_t(header->labelCount) * sizeof(BytecodeLabel);
+    if (count >= INT32_MAX
+        || header->codeOffset % alignof(DecodedInstruction) != 0
+        || header->codeOffset > fileSize || codeBytes > fileSize - header->codeOffset
+        || header->labelOffset > fileSize || labelBytes > fileSize - header->labelOffset
+        || header->labelOffset % alignof(BytecodeLabel) != 0
+        || header->namesOffset > fileSize || header->namesSize > fileSize - header->namesOffset) {
+        throw std::invalid_argument("Arquivo de bytecode truncado ou corrompido");
+    }
+
+    this->mappedCode = true;
+    this->codePtr = reinterpret_cast<const DecodedInstruction*>(data + header->codeOffset);
+    this->codeSize = count;
+
+    // validação rápida (sem cópia): opcodes conhecidos, desvios dentro do programa e END no final
+    for (unsigned i = 0; i < this->codeSize; i++) {
+        const DecodedInstruction& instr = this->codePtr[i];
+        if ((uint32_t)instr.opcode >= (uint32_t)OpCode::COUNT || instr.opcode == OpCode::END) {
+            throw std::invalid_argument("Opcode inválido no endereço " + std::to_string(i));
+        }
+        if (i + fusedLength(instr.opcode) > this->codeSize) {
+            throw std::invalid_argument("Superinstrução incompleta no endereço " + std::to_string(i));
+        }
+        if (instr.opcode >= OpCode::LDV_LDV_ADD_STR) {
+            this->superinstructions++;
+        }
+        if (Operations::takesLabel(instr.opcode) && (uint32_t)instr.op1 > this->codeSize) {
+            throw std::invalid_argument("Desvio para fora do programa no endereço " + std::to_string(i));
+        }
+        if (instr.opcode == OpCode::CALL_ALLOC && this->codePtr[instr.op1].opcode != OpCode::ALLOC) {
+            throw std::invalid_argument("Superinstrução incompleta no endereço " + std::to_string(i));
+        }
+    }
+    if (this->codePtr[this->codeSize].opcode != OpCode::END) {
+        throw std::invalid_argument("Programa binário sem terminador");
+    }
+}
+
+void Program::scanAddresses() {
+    int64_t low = INT64_MAX, high = INT64_MIN;
+    auto use = [&](int64_t first, int64_t last) {
+        low = std::min(low, first);
+        high = std::max(high, last);
+    };
+
+    // as instruções cobertas por superinstruções mantêm os opcodes originais
+    for (unsigned i = 0; i < this->codeSize; i++) {
+        const DecodedInstruction& instr = this->codePtr[i];
+        switch (originalOpcode(instr.opcode)) {
+            case OpCode::LDV:
+            case OpCode::STR:
+                use(instr.op1, instr.op1);
+                break;
+            case OpCode::ALLOC:
+            case OpCode::DALLOC:
+                if (instr.op2 > 0) use(instr.op1, (int64_t)instr.op1 + instr.op2 - 1);
+                break;
+            default:
+                break;
+        }
+    }
+
+    if (low <= high) {
+        this->minAddress = low;
+        this->maxAddress = high;
+    }
+}
+
+std::optional<Instruction> Program::sourceInstruction(unsigned address) const {
+    if (address < this->instructions.size()) {
+        return this->instructions[address];
+    }
+    if (address < this->lineOffsets.size()) {
+        // refaz o parsing só da linha pedida (usado apenas por DEBUG)
+        std::string_view text = this->image.view().substr(this->lineOffsets[address]);
+        text = text.substr(0, text.find('\n'));
+        return parseInstructions(std::string(text)).at(0);
+    }
+    return std::nullopt;
+}
+
+std::string Program::describeInstruction(unsigned address) const {
+    if (auto instr = this->sourceInstruction(address)) {
+        return instr->label.value_or("") + " " + instr->operation + " " + instr->op1.value_or("") + "," + instr->op2.value_or("");
+    }
+    if (address < this->codeSize) {
+        // programa binário: mostra a forma decodificada
+        const DecodedInstruction& instr = this->codePtr[address];
+        return std::string(" ") + Operations::getName(instr.opcode) + " " + std::to_string(instr.op1) + "," + std::to_string(instr.op2);
+    }
+    return "";
+}
+
+const std::unordered_map<std::string, int>& Program::labels() const {
+    // programas binários: os nomes só são lidos da seção de debug quando alguém precisa deles
+    if (this->labelsLoaded.load(std::memory_order_acquire)) {
+        return this->label_cache;
+    }
+
+    std::lock_guard<std::mutex> lock(this->labelsMutex);
+    if (!this->labelsLoaded.load(std::memory_order_relaxed)) {
+        const char* data = this->image.data();
+        const auto* header = reinterpret_cast<const BytecodeHeader*>(data);
+        if (header->namesOffset != 0) {
+            const auto* labels = reinterpret_cast<const BytecodeLabel*>(data + header->labelOffset);
+            const char* names = data + header->namesOffset;
+            for (uint32_t i = 0; i < header->labelCount; i++) {
+                if (uint64_t(labels[i].nameOffset) + labels[i].nameLength <= header->namesSize) {
+                    this->label_cache[std::string(names + labels[i].nameOffset, labels[i].nameLength)] = labels[i].address;
+                }
+            }
+        }
+        this->labelsLoaded.store(true, std::memory_order_release);
+    }
+    return this->label_cache;
+}
+
+const OptimizationStats& Program::optimize(int level) {
+    if (level <= 0) {
+        return this->optimization;
+    }
+    this->labels(); // programas binários: lê os nomes antes de a imagem deixar de ser usada
+    if (this->mappedCode) {
+        this->decoded.assign(this->codePtr, this->codePtr + this->codeSize + 1);
+        this->mappedCode = false;
+    }
+    // as instruções cobertas pelas superinstruções estão intactas: basta o opcode original
+    for (auto& instr : this->decoded) {
+        instr.opcode = originalOpcode(instr.opcode);
+    }
+    this->superinstructions = 0;
+
+    // os labels apontam para a própria linha, que o otimizador remove: passam a apontar
+    // para a primeira instrução depois dela
+    std::vector<std::pair<std::string, unsigned>> labelTargets;
+    for (const auto& [name, address] : this->label_cache) {
+        unsigned target = address;
+        while (target < this->codeSize && this->decoded[target].opcode == OpCode::NOP) target++;
+        labelTargets.emplace_back(name, target);
+    }
+
+    std::vector<int> addressMap;
+    this->optimization = optimizeCode(this->decoded, level, &addressMap);
+    this->codeSize = this->decoded.size() - 1;
+    this->codePtr = this->decoded.data();
+
+    this->label_cache.clear();
+    for (const auto& [name, target] : labelTargets) {
+        if (target < addressMap.size() && addressMap[target] >= 0) {
+            this->label_cache[name] = addressMap[target];
+        }
+    }
+    this->instructions.clear();
+    this->lineOffsets.clear();
+
+    this->scanAddresses();
+    this->verification = verifyStack(this->codePtr, this->codeSize);
+    return this->optimization;
+}
+
+size_t Program::fuseSuperinstructions() {
+    if (this->mappedCode) {
+        this->decoded.assign(this->codePtr, this->codePtr + this->codeSize + 1);
+        this->mappedCode = false;
+    }
+
+    this->superinstructions += ::fuseSuperinstructions(this->decoded);
+    this->codePtr = this->decoded.data();
+    return this->superinstructions;
+}
+
+size_t Program::memoryUsage() const {
+    return sizeof(Program) + this->image.size()
+        + this->instructions.capacity() * sizeof(Instruction)
+        + this->decoded.capacity() * sizeof(DecodedInstruction)
+        + this->lineOffsets.capacity() * sizeof(uint32_t)
+        + (this->codeSize + 1) * sizeof(ThreadedInstruction);
+}
+
+const ThreadedInstruction* Program::threaded(const void* const* handlers) const {
+    std::call_once(this->threadedOnce, [this, handlers] {
+        this->threadedCode.reserve(this->codeSize + 1);
+        for (unsigned i = 0; i <= this->codeSize; i++) {
+            const DecodedInstruction& instr = this->codePtr[i];
+            this->threadedCode.push_back({handlers[static_cast<size_t>(instr.opcode)], instr.op1, instr.op2});
+        }
+    });
+    return this->threadedCode.data();
+}
+
+#ifdef VM_HAS_JIT
+const JitCode& Program::jit(bool budgeted) const {
+    std::call_once(this->jitOnce[budgeted], [this, budgeted] {
+        this->jitCode[budgeted] = std::make_unique<JitCode>(*this, budgeted);
+    });
+    return *this->jitCode[budgeted];
+}
+#endif
@@ -0,0 +1,133 @@
+#ifndef PROGRAM_HPP
+#define PROGRAM_HPP
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "mapped_file.hpp"
+#include "ops.hpp"
+#include "optimizer.hpp"
+#include "parser.hpp"
+#include "verifier.hpp"
+
+class JitCode;
+
+// Estrutura para armazenar uma instrução
+struct Instruction {
+    std::optional<std::string> label;
+    std::string operation;
+    std::optional<std::string> op1;
+    std::optional<std::string> op2;
+};
+
+// Instrução com o endereço do handler já resolvido (despacho direto do motor threaded)
+struct ThreadedInstruction {
+    const void* handler;
+    int32_t op1;
+    int32_t op2;
+};
+
+// Programa carregado: instruções decodificadas e labels resolvidos.
+// Imutável depois de construído, pode ser compartilhado entre várias VMs.
+class Program {
+public:
+    // Decodifica as instruções textuais (lança exceção para operações ou labels inválidos)
+    explicit Program(const std::vector<Instruction>& instructions);
+
+    // Arquivo mapeado: imagem binária (ver bytecode.hpp), usada sem copiar as instruções,
+    // ou texto, decodificado em uma passada por parseProgram
+    explicit Program(MappedFile image);
+    // Texto já decodificado e com os labels resolvidos (carregamento em fluxo, stream_loader.hpp);
+    // os nomes dos símbolos apontam para o texto de image
+    Program(MappedFile image, ParsedProgram parsed);
+    ~Program();
+
+    // size() instruções seguidas de um END
+    const DecodedInstruction* code() const { return codePtr; }
+    unsigned size() const { return codeSize; }
+
+    // true quando as instruções vêm direto de um arquivo binário mapeado
+    bool isMapped() const { return mappedCode; }
+
+    // Conteúdo do arquivo carregado (vazio para programas criados de Instructions)
+    std::string_view source() const { return image.view(); }
+
+    // Instrução textual original no endereço (nullopt para programas binários)
+    std::optional<Instruction> sourceInstruction(unsigned address) const;
+
+    // Instrução no endereço como o DEBUG a mostra (texto original ou forma decodificada)
+    std::string describeInstruction(unsigned address) const;
+
+    // label -> endereço (vazio para programas binários sem a seção de debug)
+    const std::unordered_map<std::string, int>& labels() const;
+
+    // Otimiza o programa inteiro (optimizer.hpp) no nível dado; deve ser chamada antes da
+    // fusão e de compartilhar o programa. Os endereços mudam: os labels são remapeados (os
+    // de código removido somem) e o texto original deixa de ser usado pelo DEBUG.
+    // Superinstruções de imagens binárias são desfeitas antes e podem ser fundidas de novo.
+    const OptimizationStats& optimize(int level);
+    const OptimizationStats& optimizationStats() const { return optimization; }
+
+    // Aplica a fusão de superinstruções (peephole.hpp); deve ser chamada antes de compartilhar
+    // o programa. Imagens binárias mapeadas passam a usar uma cópia própria das instruções.
+    size_t fuseSuperinstructions();
+    size_t superinstructionCount() const { return superinstructions; }
+
+    // Menor e maior posição da pilha acessada por endereço fixo (LDV, STR, ALLOC, DALLOC);
+    // lowestAddress() > highestAddress() se nenhuma instrução acessa a pilha assim
+    int64_t lowestAddress() const { return minAddress; }
+    int64_t highestAddress() const { return maxAddress; }
+
+    // Verificação da pilha feita no carregamento (verifier.hpp); com a pilha provada, os
+    // motores threaded e JIT dispensam as checagens de valores insuficientes
+    bool stackVerified() const { return verification.verified; }
+    int64_t maxStackDepth() const { return verification.maxDepth; }
+
+    // Memória aproximada do programa carregado (arquivo, instruções e a tradução para
+    // despacho direto, mesmo antes de construída); o código do JIT não é contado
+    size_t memoryUsage() const;
+
+    // Programa traduzido para despacho direto; construído uma vez, na primeira chamada
+    const ThreadedInstruction* threaded(const void* const* handlers) const;
+
+    // Programa traduzido para código nativo (jit.hpp); construído uma vez, na primeira chamada.
+    // A variante budgeted checa o limite de instruções antes de cada instrução.
+    const JitCode& jit(bool budgeted = false) const;
+
+private:
+    void decode();
+    void loadBytecode();
+    void loadText(ParsedProgram parsed);
+    void scanAddresses();
+
+    std::vector<Instruction> instructions;
+    std::vector<DecodedInstruction> decoded;
+    MappedFile image;
+    bool mappedCode = false;
+    std::vector<uint32_t> lineOffsets; // programas texto mapeados: início de cada linha
+
+    const DecodedInstruction* codePtr = nullptr;
+    unsigned codeSize = 0;
+    size_t superinstructions = 0;
+    OptimizationStats optimization;
+    int64_t minAddress = 0;
+    int64_t maxAddress = -1;
+    StackVerification verification;
+
+    // programas texto preenchem label_cache na carga; binários, no primeiro labels()
+    mutable std::unordered_map<std::string, int> label_cache;
+    mutable std::atomic<bool> labelsLoaded{false};
+    mutable std::mutex labelsMutex;
+
+    mutable std::vector<ThreadedInstruction> threadedCode;
+    mutable std::once_flag threadedOnce;
+
+    mutable std::unique_ptr<JitCode> jitCode[2];
+    mutable std::once_flag jitOnce[2];
+};
+
+#endif // PROGRAM_HPP
@@ -0,0 +1,149 @@
+#include "program_cache.hpp"
+#include <cstring>
+
+uint64_t hashContents(std::string_view data) {
+    const uint64_t k1 = 0x87c37b91114253d5ULL, k2 = 0x4cf5ad432745937fULL;
+    auto mix = [&](uint64_t h, uint64_t word) {
+        word *= k1;
+        word = (word << 31) | (word >> 33);
+        h ^= word * k2;
+        return ((h << 27) | (h >> 37)) * 5 + 0x52dce729;
+    };
+
+    uint64_t h = 0x9e3779b97f4a7c15ULL ^ data.size();
+    size_t i = 0;
+    for (; i + 8 <= data.size(); i += 8) {
+        uint64_t word;
+        std::memcpy(&word, data.data() + i, 8);
+        h = mix(h, word);
+    }
+    if (i < data.size()) {
+        uint64_t word = 0;
+        std::memcpy(&word, data.data() + i, data.size() - i);
+        h = mix(h, word);
+    }
+
+    // finalização do murmur3: espalha todos os bits
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    return h ^ (h >> 33);
+}
+
+ProgramCache::ProgramCache(size_t capacity) : limit(capacity) {}
+
+std::shared_ptr<const Program> ProgramCache::load(const std::string& filePath, const LoadOptions& options) {
+    MappedFile file(filePath);
+    const Key key{hashContents(file.view()), file.size(), options.fuse, options.optimize};
+
+    std::promise<std::shared_ptr<const Program>> loading;
+    {
+        std::unique_lock<std::mutex> lock(this->mutex);
+        if (this->limit == 0) {
+            this->misses++;
+            lock.unlock();
+            return loadProgram(std::move(file), options);
+        }
+
+        auto it = this->entries.find(key);
+        if (it != this->entries.end()) {
+            this->recency.splice(this->recency.begin(), this->recency, it->second.recent);
+            std::shared_future<std::shared_ptr<const Program>> future = it->second.program;
+            lock.unlock();
+
+            // espera se outra thread ainda está carregando
+            std::shared_ptr<const Program> program = future.get();
+            const bool same = program->source() == file.view();
+            lock.lock();
+            if (same) {
+                this->hits++;
+                return program;
+            }
+            // colisão do hash: outro conteúdo com o mesmo hash e tamanho
+            this->misses++;
+            lock.unlock();
+            return loadProgram(std::move(file), options);
+        }
+
+        this->misses++;
+        this->recency.push_front(key);
+        this->entries.emplace(key, Entry{loading.get_future().share(), 0, this->recency.begin()});
+    }
+
+    // decodifica fora do mutex; quem pedir o mesmo conteúdo enquanto isso espera o future
+    std::shared_ptr<const Program> program;
+    try {
+        program = loadProgram(std::move(file), options);
+    } catch (...) {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        auto it = this->entries.find(key);
+        if (it != this->entries.end() && it->second.bytes == 0) {
+            this->recency.erase(it->second.recent);
+            this->entries.erase(it);
+        }
+        loading.set_exception(std::current_exception());
+        throw;
+    }
+
+    std::lock_guard<std::mutex> lock(this->mutex);
+    auto it = this->entries.find(key);
+    if (it != this->entries.end() && it->second.bytes == 0) {
+        it->second.bytes = program->memoryUsage();
+        this->bytes += it->second.bytes;
+        this->evict();
+    }
+    loading.set_value(program);
+    return program;
+}
+
+void ProgramCache::evict() {
+    // os programas em carregamento (bytes == 0) ainda não ocupam espaço
+    auto it = this->recency.end();
+    while (this->bytes > this->limit && it != this->recency.begin()) {
+        --it;
+        auto entry = this->entries.find(*it);
+        if (entry->second.bytes == 0) {
+            continue;
+        }
+        this->bytes -= entry->second.bytes;
+        this->entries.erase(entry);
+        it = this->recency.erase(it);
+    }
+}
+
+void ProgramCache::setCapacity(size_t capacity) {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    this->limit = capacity;
+    this->evict();
+}
+
+void ProgramCache::clear() {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    for (auto it = this->recency.begin(); it != this->recency.end();) {
+        auto entry = this->entries.find(*it);
+        if (entry->second.bytes == 0) {
+            ++it;
+            continue;
+        }
+        this->bytes -= entry->second.bytes;
+        this->entries.erase(entry);
+        it = this->recency.erase(it);
+    }
+}
+
+ProgramCache::Stats ProgramCache::stats() const {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    Stats result;
+    result.hits = this->hits;
+    result.misses = this->misses;
+    result.entries = this->entries.size();
+    result.bytes = this->bytes;
+    result.capacity = this->limit;
+    return result;
+}
+
+ProgramCache& programCache() {
+    static ProgramCache cache;
+    return cache;
+}
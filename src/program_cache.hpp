@@ -0,0 +1,87 @@
+#ifndef PROGRAM_CACHE_HPP
+#define PROGRAM_CACHE_HPP
+
+#include <cstdint>
+#include <future>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include "loader.hpp"
+#include "program.hpp"
+
+constexpr size_t DEFAULT_PROGRAM_CACHE_SIZE = 64 << 20; // bytes
+
+// Cache de programas carregados (já com as superinstruções), indexado por um hash do
+// conteúdo do arquivo: recarregar um arquivo que não mudou só custa mapeá-lo, calcular o
+// hash e comparar o conteúdo com o do programa encontrado (o hash não é criptográfico; numa
+// colisão o arquivo é carregado sem o cache), e a imagem (com as traduções para despacho
+// direto e JIT já feitas) é reaproveitada.
+// Os programas são imutáveis e compartilhados entre as VMs que os carregam.
+//
+// Seguro entre threads. Carregamentos simultâneos do mesmo conteúdo esperam o primeiro em
+// vez de decodificar de novo. Quando a memória estimada (Program::memoryUsage) passa da
+// capacidade, os programas usados há mais tempo saem do cache; as VMs que já os usam
+// continuam com a sua referência.
+class ProgramCache {
+public:
+    explicit ProgramCache(size_t capacity = DEFAULT_PROGRAM_CACHE_SIZE);
+
+    ProgramCache(const ProgramCache&) = delete;
+    ProgramCache& operator=(const ProgramCache&) = delete;
+
+    // Como loadProgram; lança as mesmas exceções (um erro não fica no cache)
+    std::shared_ptr<const Program> load(const std::string& filePath, const LoadOptions& options = {});
+
+    // Capacidade em bytes; 0 desliga o cache (load passa a carregar sempre)
+    void setCapacity(size_t bytes);
+    void clear();
+
+    struct Stats {
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+        size_t entries = 0;
+        size_t bytes = 0;    // memória estimada dos programas no cache
+        size_t capacity = 0;
+    };
+    Stats stats() const;
+
+private:
+    struct Key {
+        uint64_t hash;
+        size_t length;
+        bool fuse;
+        int optimize;
+        bool operator==(const Key& other) const {
+            return hash == other.hash && length == other.length && fuse == other.fuse && optimize == other.optimize;
+        }
+    };
+    struct KeyHash {
+        size_t operator()(const Key& key) const { return size_t(key.hash ^ key.fuse ^ ((uint64_t)key.optimize << 1)); }
+    };
+    struct Entry {
+        std::shared_future<std::shared_ptr<const Program>> program; // pronto ou em carregamento
+        size_t bytes = 0;                 // 0 enquanto carrega
+        std::list<Key>::iterator recent;  // posição em recency
+    };
+
+    void evict(); // com mutex travado
+
+    mutable std::mutex mutex;
+    std::unordered_map<Key, Entry, KeyHash> entries;
+    std::list<Key> recency; // do usado mais recentemente para o menos
+    size_t limit;
+    size_t bytes = 0;
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+};
+
+// Hash de 64 bits do conteúdo, lido em palavras de 8 bytes
+uint64_t hashContents(std::string_view data);
+
+// Cache compartilhado pelo processo (usado por vm_load e pelo lote)
+ProgramCache& programCache();
+
+#endif // PROGRAM_CACHE_HPP
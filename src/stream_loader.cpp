@@ -0,0 +1,106 @@
+#include "stream_loader.hpp"
+#include "bytecode.hpp"
+#include <stdexcept>
+
+StreamingProgram::StreamingProgram(const std::string& filePath, const LoadOptions& options)
+    : StreamingProgram(MappedFile(filePath), options) {}
+
+StreamingProgram::StreamingProgram(MappedFile image, const LoadOptions& options) : file(std::move(image)) {
+    if (options.optimize > 0) {
+        throw std::invalid_argument("O carregamento em fluxo não pode ser usado com o otimizador");
+    }
+    if (isBytecode(this->file.view())) {
+        this->complete = loadProgram(std::move(this->file), options);
+        this->finished.store(true, std::memory_order_release);
+        return;
+    }
+    this->worker = std::thread(&StreamingProgram::run, this, options);
+}
+
+StreamingProgram::~StreamingProgram() {
+    this->stopping.store(true, std::memory_order_relaxed);
+    if (this->worker.joinable()) {
+        this->worker.join();
+    }
+}
+
+void StreamingProgram::run(LoadOptions options) {
+    try {
+        {
+            std::lock_guard<std::mutex> lock(this->mutex);
+            this->parser.emplace(this->file.view());
+            this->code = this->parser->program().code.data();
+        }
+
+        for (bool more = true; more;) {
+            if (this->stopping.load(std::memory_order_relaxed)) {
+                throw std::runtime_error("Carregamento interrompido");
+            }
+            {
+                std::lock_guard<std::mutex> lock(this->mutex);
+                more = this->parser->parse(STREAM_CHUNK_LINES);
+                this->published.store((unsigned)this->parser->program().code.size(), std::memory_order_release);
+            }
+            this->progress.notify_all();
+        }
+
+        // cópia: a VM continua lendo as instruções publicadas, com os desvios por símbolo
+        ParsedProgram parsed = this->parser->program();
+        resolveLabels(parsed);
+        auto program = std::make_shared<Program>(std::move(this->file), std::move(parsed));
+        if (options.fuse) {
+            program->fuseSuperinstructions();
+        }
+        this->complete = std::move(program);
+    } catch (...) {
+        this->error = std::current_exception();
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->finished.store(true, std::memory_order_release);
+    }
+    this->progress.notify_all();
+}
+
+const DecodedInstruction* StreamingProgram::waitInstruction(unsigned address) {
+    std::unique_lock<std::mutex> lock(this->mutex);
+    this->progress.wait(lock, [&] { return address < this->published.load() || this->finished.load(); });
+    if (address < this->published.load()) {
+        return this->code + address;
+    }
+    if (this->error) std::rethrow_exception(this->error);
+    return nullptr;
+}
+
+int32_t StreamingProgram::resolve(int symbol) {
+    std::unique_lock<std::mutex> lock(this->mutex);
+    auto labelAddress = [&]() -> int32_t {
+        if (!this->parser) return -1;
+        const auto& addresses = this->parser->program().labelAddress;
+        return (size_t)symbol < addresses.size() ? addresses[symbol] : -1;
+    };
+
+    this->progress.wait(lock, [&] { return labelAddress() >= 0 || this->finished.load(); });
+    int32_t target = labelAddress();
+    if (target < 0) {
+        if (this->error) std::rethrow_exception(this->error);
+        throw std::invalid_argument("Label não encontrado: " + std::string(this->parser->program().symbols.name(symbol)));
+    }
+
+    // como resolveLabels: a primeira instrução depois do(s) label(s)
+    while (true) {
+        this->progress.wait(lock, [&] { return (unsigned)target < this->published.load() || this->finished.load(); });
+        if ((unsigned)target >= this->published.load() || this->code[target].opcode != OpCode::NOP) {
+            return target;
+        }
+        target++;
+    }
+}
+
+std::shared_ptr<const Program> StreamingProgram::wait() {
+    std::unique_lock<std::mutex> lock(this->mutex);
+    this->progress.wait(lock, [&] { return this->finished.load(); });
+    lock.unlock();
+    return this->program();
+}
@@ -0,0 +1,81 @@
+#ifndef STREAM_LOADER_HPP
+#define STREAM_LOADER_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include "loader.hpp"
+#include "parser.hpp"
+#include "program.hpp"
+
+constexpr size_t STREAM_CHUNK_LINES = 4096; // linhas decodificadas entre duas publicações
+
+// Carregamento em fluxo de programas texto: uma thread faz o parsing do arquivo em trechos
+// (ProgramParser) enquanto a VM já executa as instruções publicadas (VirtualMachine::startVM
+// com um StreamingProgram). Uma instrução ainda não decodificada, ou um desvio para um label
+// ainda não visto, espera o parsing chegar lá. Terminado o parsing, o programa completo
+// (labels resolvidos, superinstruções, verificação da pilha) é construído na mesma thread, e a
+// VM passa a usá-lo no próximo despacho, com o motor pedido: os endereços são os mesmos.
+//
+// Erros de parsing aparecem quando a execução chega à linha com erro ou ao trocar para o
+// programa completo; uma execução que termina antes disso não os vê. Arquivos binários são
+// carregados de uma vez, sem a thread. O otimizador (-O1/-O2) muda os endereços e não pode
+// ser usado assim (std::invalid_argument).
+class StreamingProgram {
+public:
+    explicit StreamingProgram(const std::string& filePath, const LoadOptions& options = {});
+    StreamingProgram(MappedFile file, const LoadOptions& options = {});
+    ~StreamingProgram(); // interrompe o parsing, se ainda não terminou
+
+    StreamingProgram(const StreamingProgram&) = delete;
+    StreamingProgram& operator=(const StreamingProgram&) = delete;
+
+    // Instrução no endereço, esperando o parsing chegar a ela; nullptr se o texto acabou antes.
+    // Nos desvios, op1 é o id do símbolo do label (ver resolve).
+    const DecodedInstruction* instruction(unsigned address) {
+        if (address < this->published.load(std::memory_order_acquire)) {
+            return this->code + address;
+        }
+        return this->waitInstruction(address);
+    }
+
+    // Destino de um desvio: a primeira instrução depois do label, esperando o parsing
+    // encontrá-lo (std::invalid_argument se o texto acaba sem ele)
+    int32_t resolve(int symbol);
+
+    // Programa completo quando pronto (nullptr antes); lança o erro de parsing, se houve
+    std::shared_ptr<const Program> program() const {
+        if (!this->finished.load(std::memory_order_acquire)) {
+            return nullptr;
+        }
+        if (this->error) std::rethrow_exception(this->error);
+        return this->complete;
+    }
+
+    // Espera o parsing terminar e retorna o programa completo
+    std::shared_ptr<const Program> wait();
+
+private:
+    void run(LoadOptions options);
+    const DecodedInstruction* waitInstruction(unsigned address);
+
+    MappedFile file; // passa para o programa completo (o endereço do texto não muda)
+    std::optional<ProgramParser> parser; // criado e alterado pela thread do parsing, com o mutex
+    const DecodedInstruction* code = nullptr; // parser->program().code, com a capacidade reservada
+    std::atomic<unsigned> published{0}; // instruções que a VM já pode executar
+    std::atomic<bool> finished{false};
+    std::atomic<bool> stopping{false};
+    std::shared_ptr<const Program> complete;
+    std::exception_ptr error;
+
+    mutable std::mutex mutex;
+    std::condition_variable progress; // mais instruções publicadas ou fim do parsing
+    std::thread worker;
+};
+
+#endif // STREAM_LOADER_HPP
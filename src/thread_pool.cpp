@@ -0,0 +1,93 @@
+#include "thread_pool.hpp"
+#include <algorithm>
+
+WorkStealingPool::WorkStealingPool(unsigned threads) {
+    if (threads == 0) {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    for (unsigned i = 0; i < threads; i++) {
+        this->queues.push_back(std::make_unique<Queue>());
+    }
+    for (unsigned i = 0; i < threads; i++) {
+        this->workers.emplace_back(&WorkStealingPool::run, this, i);
+    }
+}
+
+WorkStealingPool::~WorkStealingPool() {
+    this->wait();
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->stopping = true;
+    }
+    this->wake.notify_all();
+    for (auto& worker : this->workers) {
+        worker.join();
+    }
+}
+
+void WorkStealingPool::submit(Task task) {
+    Queue& queue = *this->queues[this->nextQueue++ % this->queues.size()];
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->pending++;
+    }
+    {
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        queue.tasks.push_back(std::move(task));
+    }
+    this->queued++;
+    {
+        // garante que um worker entre a checagem de queued e o wait não perca o aviso
+        std::lock_guard<std::mutex> lock(this->mutex);
+    }
+    this->wake.notify_one();
+}
+
+void WorkStealingPool::wait() {
+    std::unique_lock<std::mutex> lock(this->mutex);
+    this->idle.wait(lock, [this] { return this->pending == 0; });
+}
+
+// Próxima tarefa: do fim da própria fila ou, se ela estiver vazia, do início da fila de outro worker
+bool WorkStealingPool::take(unsigned worker, Task& task) {
+    const size_t count = this->queues.size();
+    for (size_t k = 0; k < count; k++) {
+        Queue& queue = *this->queues[(worker + k) % count];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (queue.tasks.empty()) {
+            continue;
+        }
+        if (k == 0) {
+            task = std::move(queue.tasks.back());
+            queue.tasks.pop_back();
+        } else {
+            task = std::move(queue.tasks.front());
+            queue.tasks.pop_front();
+        }
+        this->queued--;
+        return true;
+    }
+    return false;
+}
+
+void WorkStealingPool::run(unsigned worker) {
+    for (;;) {
+        Task task;
+        if (this->take(worker, task)) {
+            task(worker);
+
+            std::lock_guard<std::mutex> lock(this->mutex);
+            if (--this->pending == 0) {
+                this->idle.notify_all();
+            }
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(this->mutex);
+        this->wake.wait(lock, [this] { return this->stopping || this->queued > 0; });
+        if (this->stopping && this->queued == 0) {
+            return;
+        }
+    }
+}
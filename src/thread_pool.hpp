@@ -0,0 +1,55 @@
+#ifndef THREAD_POOL_HPP
+#define THREAD_POOL_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Pool de threads com roubo de tarefas: cada worker tem a sua fila; as tarefas novas são
+// distribuídas entre as filas e um worker sem trabalho rouba do início da fila de outro.
+// As tarefas recebem o índice do worker, para reaproveitar estado por thread.
+class WorkStealingPool {
+public:
+    typedef std::function<void(unsigned worker)> Task;
+
+    explicit WorkStealingPool(unsigned threads = 0); // 0: um worker por núcleo
+    ~WorkStealingPool();                              // espera as tarefas pendentes
+
+    WorkStealingPool(const WorkStealingPool&) = delete;
+    WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+    unsigned size() const { return (unsigned)workers.size(); }
+
+    // As tarefas não devem lançar exceções
+    void submit(Task task);
+
+    // Bloqueia até todas as tarefas submetidas terminarem
+    void wait();
+
+private:
+    struct Queue {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    bool take(unsigned worker, Task& task);
+    void run(unsigned worker);
+
+    std::vector<std::unique_ptr<Queue>> queues;
+    std::vector<std::thread> workers;
+    std::atomic<unsigned> nextQueue{0};
+    std::atomic<size_t> queued{0}; // tarefas nas filas, ainda não iniciadas
+
+    std::mutex mutex;
+    std::condition_variable wake; // há tarefas nas filas ou o pool está parando
+    std::condition_variable idle; // pending chegou a zero
+    size_t pending = 0;           // tarefas submetidas e não terminadas
+    bool stopping = false;
+};
+
+#endif // THREAD_POOL_HPP
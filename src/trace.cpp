@@ -0,0 +1,287 @@
+#include "trace.hpp"
+#include "mapped_file.hpp"
+#include "program_cache.hpp"
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <string_view>
+
+// Formato do arquivo: TraceHeader, e para cada trecho um TraceSegment seguido das
+// posições da pilha do checkpoint (int32) e dos bytes dos eventos
+static const char TRACE_MAGIC[4] = {'V', 'M', 'T', 'R'};
+constexpr uint32_t TRACE_VERSION = 1;
+
+struct TraceHeader {
+    char magic[4];
+    uint32_t version;
+    uint64_t programHash;  // hashContents do código carregado (com superinstruções e o END)
+    uint64_t segmentCount;
+    uint64_t finalInstructions;
+    int32_t finalIp;
+    int32_t finalSp;
+};
+
+struct TraceSegment {
+    uint64_t dispatches;
+    uint64_t lastEvent;
+    uint64_t stackSize;
+    uint64_t eventBytes;
+    int32_t ip;
+    int32_t sp;
+    int32_t startSp;
+    int32_t callDepth;
+};
+
+static uint64_t programHash(const Program& program) {
+    return hashContents(std::string_view(reinterpret_cast<const char*>(program.code()),
+                                         (uint64_t(program.size()) + 1) * sizeof(DecodedInstruction)));
+}
+
+// Inteiros sem sinal em varint (7 bits por byte, o bit alto indica que há mais bytes) e
+// com sinal em zigzag (0, -1, 1, -2, ... viram 0, 1, 2, 3, ...)
+static void putVarint(std::vector<uint8_t>& out, uint64_t value) {
+    while (value >= 0x80) {
+        out.push_back(uint8_t(value) | 0x80);
+        value >>= 7;
+    }
+    out.push_back(uint8_t(value));
+}
+
+static uint64_t getVarint(const std::vector<uint8_t>& in, size_t& pos) {
+    uint64_t value = 0;
+    for (unsigned shift = 0; pos < in.size() && shift < 64; shift += 7) {
+        uint8_t byte = in[pos++];
+        value |= uint64_t(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) return value;
+    }
+    throw std::invalid_argument("Registro de execução corrompido");
+}
+
+static uint64_t zigzag(int64_t value) {
+    return (uint64_t(value) << 1) ^ uint64_t(value >> 63);
+}
+
+static int64_t unzigzag(uint64_t value) {
+    return int64_t(value >> 1) ^ -int64_t(value & 1);
+}
+
+Tracer::Tracer(uint64_t checkpointInterval, size_t capacity)
+    : interval(checkpointInterval ? checkpointInterval : 1), capacity(capacity) {}
+
+size_t Tracer::segmentBytes(const Segment& segment) {
+    return sizeof(TraceSegment) + segment.checkpoint.stack.size() * sizeof(int) + segment.events.size();
+}
+
+void Tracer::checkpoint(VMSnapshot state) {
+    // o checkpoint é tirado no meio da execução; restaurado, a VM fica como se tivesse
+    // parado pelo limite de instruções naquele ponto
+    state.status = ExecStatus::BudgetExhausted;
+
+    Segment segment;
+    segment.lastEvent = state.dispatches;
+    segment.checkpoint = std::move(state);
+    if (!this->segments.empty()) {
+        segment.events.reserve(this->segments.back().events.size());
+    }
+    this->size += segmentBytes(segment);
+    this->segments.push_back(std::move(segment));
+
+    while (this->capacity && this->size > this->capacity && this->segments.size() > 1) {
+        this->size -= segmentBytes(this->segments.front());
+        this->segments.pop_front();
+    }
+}
+
+// Cabeçalho do evento: instruções desde o evento anterior e o tipo; depois o valor
+void Tracer::record(Event kind, uint64_t dispatch, int64_t value) {
+    if (this->segments.empty()) return;
+
+    Segment& segment = this->segments.back();
+    const size_t before = segment.events.size();
+    putVarint(segment.events, (dispatch - segment.lastEvent) << 1 | uint64_t(kind));
+    putVarint(segment.events, zigzag(value));
+    segment.lastEvent = dispatch;
+    this->size += segment.events.size() - before;
+}
+
+template <typename Visit>
+void Tracer::decode(const Segment& segment, Visit visit) {
+    uint64_t dispatch = segment.checkpoint.dispatches;
+    size_t pos = 0;
+    while (pos < segment.events.size()) {
+        const size_t offset = pos;
+        const uint64_t header = getVarint(segment.events, pos);
+        const int64_t value = unzigzag(getVarint(segment.events, pos));
+        dispatch += header >> 1;
+        visit(Event(header & 1), dispatch, value, offset);
+    }
+}
+
+uint64_t Tracer::firstInstruction() const {
+    return this->segments.empty() ? 0 : this->segments.front().checkpoint.dispatches;
+}
+
+void Tracer::truncate(uint64_t instruction) {
+    while (!this->segments.empty() && this->segments.back().checkpoint.dispatches > instruction) {
+        this->size -= segmentBytes(this->segments.back());
+        this->segments.pop_back();
+    }
+    if (this->segments.empty()) return;
+
+    Segment& segment = this->segments.back();
+    size_t cut = segment.events.size();
+    uint64_t last = segment.checkpoint.dispatches;
+    decode(segment, [&](Event, uint64_t dispatch, int64_t, size_t offset) {
+        if (cut != segment.events.size()) return;
+        if (dispatch > instruction) {
+            cut = offset;
+        } else {
+            last = dispatch;
+        }
+    });
+    this->size -= segment.events.size() - cut;
+    segment.events.resize(cut);
+    segment.lastEvent = last;
+}
+
+void Tracer::write(const std::string& path, const VirtualMachine& end) const {
+    TraceHeader header{};
+    std::memcpy(header.magic, TRACE_MAGIC, sizeof(TRACE_MAGIC));
+    header.version = TRACE_VERSION;
+    header.programHash = programHash(end.getProgram());
+    header.segmentCount = this->segments.size();
+    header.finalInstructions = end.dispatches;
+    header.finalIp = end.ip;
+    header.finalSp = end.sp;
+
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file) {
+        throw std::runtime_error("Não foi possível criar o arquivo: " + path);
+    }
+
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    for (const Segment& segment : this->segments) {
+        const VMSnapshot& state = segment.checkpoint;
+        TraceSegment entry{};
+        entry.dispatches = state.dispatches;
+        entry.lastEvent = segment.lastEvent;
+        entry.stackSize = state.stack.size();
+        entry.eventBytes = segment.events.size();
+        entry.ip = state.ip;
+        entry.sp = state.sp;
+        entry.startSp = state.start_sp;
+        entry.callDepth = (int32_t)state.callDepth;
+
+        file.write(reinterpret_cast<const char*>(&entry), sizeof(entry));
+        file.write(reinterpret_cast<const char*>(state.stack.data()), state.stack.size() * sizeof(int));
+        file.write(reinterpret_cast<const char*>(segment.events.data()), segment.events.size());
+    }
+
+    if (!file) {
+        throw std::runtime_error("Erro ao gravar o arquivo: " + path);
+    }
+}
+
+Tracer Tracer::read(const std::string& path, std::shared_ptr<const Program> program) {
+    MappedFile file(path);
+    const char* data = file.data();
+    const size_t length = file.size();
+    size_t pos = 0;
+
+    auto take = [&](void* out, uint64_t bytes) {
+        if (bytes > length - pos) {
+            throw std::invalid_argument("Registro de execução truncado: " + path);
+        }
+        std::memcpy(out, data + pos, bytes);
+        pos += bytes;
+    };
+
+    TraceHeader header;
+    take(&header, sizeof(header));
+    if (std::memcmp(header.magic, TRACE_MAGIC, sizeof(TRACE_MAGIC)) != 0 || header.version != TRACE_VERSION) {
+        throw std::invalid_argument("Não é um registro de execução: " + path);
+    }
+    if (header.programHash != programHash(*program)) {
+        throw std::invalid_argument("O registro " + path + " é de outro programa (ou de outras opções de carga)");
+    }
+
+    Tracer tracer;
+    tracer.finalIp = header.finalIp;
+    tracer.finalSp = header.finalSp;
+    tracer.finalInstructions = header.finalInstructions;
+    for (uint64_t i = 0; i < header.segmentCount; i++) {
+        TraceSegment entry;
+        take(&entry, sizeof(entry));
+        if (entry.stackSize > (length - pos) / sizeof(int)) {
+            throw std::invalid_argument("Registro de execução truncado: " + path);
+        }
+
+        Segment segment;
+        VMSnapshot& state = segment.checkpoint;
+        state.program = program;
+        state.ip = entry.ip;
+        state.sp = entry.sp;
+        state.start_sp = entry.startSp;
+        state.callDepth = entry.callDepth;
+        state.dispatches = entry.dispatches;
+        state.status = ExecStatus::BudgetExhausted;
+        state.stack.resize(entry.stackSize);
+        take(state.stack.data(), entry.stackSize * sizeof(int));
+        segment.events.resize(entry.eventBytes);
+        take(segment.events.data(), entry.eventBytes);
+        segment.lastEvent = entry.lastEvent;
+
+        tracer.size += segmentBytes(segment);
+        tracer.segments.push_back(std::move(segment));
+    }
+    return tracer;
+}
+
+ExecStatus Tracer::replay(VirtualMachine& vm, uint64_t instruction, WriteFn write, Engine engine) const {
+    size_t first = this->segments.size();
+    while (first > 0 && this->segments[first - 1].checkpoint.dispatches > instruction) {
+        first--;
+    }
+    if (first == 0) {
+        throw std::out_of_range("O registro começa na instrução " + std::to_string(this->firstInstruction())
+            + ", depois de " + std::to_string(instruction));
+    }
+    first--;
+
+    std::vector<int> input;
+    for (size_t i = first; i < this->segments.size(); i++) {
+        decode(this->segments[i], [&](Event kind, uint64_t, int64_t value, size_t) {
+            if (kind == Event::Read) input.push_back(int(value));
+        });
+    }
+
+    vm.restore(this->segments[first].checkpoint);
+    if (instruction == vm.dispatches) {
+        return vm.status;
+    }
+
+    int output[256];
+    IOBuffers io;
+    io.input = input.data();
+    io.inputSize = input.size();
+    io.output = output;
+    io.outputCapacity = sizeof(output) / sizeof(output[0]);
+    io.user = &write;
+    io.flush = [](const int* values, size_t count, void* user) {
+        WriteFn write = *static_cast<WriteFn*>(user);
+        for (size_t i = 0; write && i < count; i++) write(values[i]);
+    };
+
+    const uint64_t budget = vm.budget;
+    vm.budget = instruction == UINT64_MAX ? 0 : instruction - vm.dispatches;
+    ExecStatus status;
+    try {
+        status = vm.execute(io, engine);
+    } catch (...) {
+        vm.budget = budget;
+        throw;
+    }
+    vm.budget = budget;
+    io.flush(io.output, io.outputSize, io.user);
+    return status;
+}
@@ -0,0 +1,91 @@
+#ifndef TRACE_HPP
+#define TRACE_HPP
+
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <string>
+#include <vector>
+#include "peephole.hpp"
+#include "vm.hpp"
+
+constexpr uint64_t DEFAULT_CHECKPOINT_INTERVAL = 1 << 20; // instruções entre checkpoints
+
+// Registro compacto de uma execução, para reproduzi-la sem a entrada original.
+//
+// O registro é dividido em trechos; cada um começa com um checkpoint (VMSnapshot da VM
+// naquele ponto) e guarda, em varints, os eventos que a execução não determina sozinha ou
+// que mudam o fluxo: o valor lido por cada RD e, a cada desvio (JMP, JMPF tomado, CALL,
+// RETURN, ...), a diferença entre o ip alcançado e o da instrução seguinte. Cada evento
+// leva também quantas instruções se passaram desde o anterior, então a sequência de ips
+// (inclusive as decisões dos JMPFs) pode ser refeita só a partir do registro.
+//
+// Com capacity, a cada checkpoint os trechos mais antigos são descartados enquanto o
+// registro passar desse tamanho em bytes (o trecho atual sempre fica). Só é alimentado pela
+// variante instrumentada do motor de tabela (VirtualMachine::tracer), como o profiler.
+class Tracer {
+public:
+    explicit Tracer(uint64_t checkpointInterval = DEFAULT_CHECKPOINT_INTERVAL, size_t capacity = 0);
+
+    // Chamados pela VM instrumentada: checkpoint antes da instrução, quando devido, e a
+    // instrução depois de executada (dispatch é o número dela, contando a partir de 1)
+    bool checkpointDue(uint64_t dispatches) const {
+        return this->segments.empty() || dispatches - this->segments.back().checkpoint.dispatches >= this->interval;
+    }
+    void checkpoint(VMSnapshot state);
+    void onInstruction(uint64_t dispatch, unsigned address, OpCode op, int ip, int top) {
+        if (op == OpCode::RD) {
+            this->record(Event::Read, dispatch, top);
+        } else if ((unsigned)ip != address + fusedLength(op)) {
+            this->record(Event::Jump, dispatch, ip - (int64_t)(address + fusedLength(op)));
+        }
+    }
+
+    // Primeira instrução que o registro consegue reproduzir (a do checkpoint mais antigo)
+    uint64_t firstInstruction() const;
+    size_t bytes() const { return this->size; }
+
+    // Descarta o que foi registrado depois da instrução (para continuar a gravar de lá)
+    void truncate(uint64_t instruction);
+
+    // Arquivo binário: cabeçalho com o hash do programa carregado, os trechos e o estado
+    // final (ip, sp e instruções de `end`). read confere o hash (lança
+    // std::invalid_argument se o registro é de outro programa ou de outras opções de carga)
+    void write(const std::string& path, const VirtualMachine& end) const;
+    static Tracer read(const std::string& path, std::shared_ptr<const Program> program);
+
+    // Estado final gravado no arquivo (lidos por read)
+    int finalIp = 0;
+    int finalSp = -1;
+    uint64_t finalInstructions = 0;
+
+    // Leva vm ao estado depois de `instruction` instruções da execução registrada
+    // (UINT64_MAX: até o fim): restaura o checkpoint anterior mais próximo e reexecuta a
+    // partir dele com os valores de RD do registro, parando exatamente na instrução pelo
+    // limite de instruções da VM. Os PRNs vão para write (nullptr: descartados). vm não deve
+    // estar gravando. Retorna NeedsInput quando o registro acaba antes.
+    ExecStatus replay(VirtualMachine& vm, uint64_t instruction = UINT64_MAX, WriteFn write = nullptr,
+                      Engine engine = DEFAULT_ENGINE) const;
+
+private:
+    enum class Event : uint8_t { Jump, Read };
+
+    struct Segment {
+        VMSnapshot checkpoint;
+        std::vector<uint8_t> events;
+        uint64_t lastEvent = 0; // número da instrução do último evento (ou do checkpoint)
+    };
+
+    // visit(tipo, número da instrução, valor, posição do evento em events)
+    template <typename Visit> static void decode(const Segment& segment, Visit visit);
+
+    void record(Event kind, uint64_t dispatch, int64_t value);
+    static size_t segmentBytes(const Segment& segment);
+
+    uint64_t interval;
+    size_t capacity;
+    size_t size = 0;
+    std::deque<Segment> segments;
+};
+
+#endif // TRACE_HPP
@@ -0,0 +1,259 @@
+#include "verifier.hpp"
+#include <algorithm>
+#include <climits>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "peephole.hpp"
+
+namespace {
+
+constexpr int64_t UNSEEN = INT64_MIN;
+constexpr unsigned MAIN = 0; // contexto do programa principal
+
+// Valores que a instrução desempilha (antes de empilhar o resultado)
+int64_t popped(const DecodedInstruction& instr) {
+    switch (instr.opcode) {
+        case OpCode::ADD: case OpCode::SUB: case OpCode::MULT: case OpCode::DIVI:
+        case OpCode::AND: case OpCode::OR:
+        case OpCode::CME: case OpCode::CMA: case OpCode::CEQ: case OpCode::CDIF:
+        case OpCode::CMEQ: case OpCode::CMAQ:
+            return 2;
+        case OpCode::INV: case OpCode::NEG: case OpCode::JMPF: case OpCode::PRN:
+        case OpCode::STR: case OpCode::RETURN:
+            return 1;
+        case OpCode::DALLOC:
+            return std::max(instr.op2, 0);
+        default:
+            return 0;
+    }
+}
+
+// Variação da altura da pilha, para as instruções que seguem para a próxima
+int64_t effect(const DecodedInstruction& instr) {
+    switch (instr.opcode) {
+        case OpCode::LDC: case OpCode::LDV: case OpCode::RD:
+            return 1;
+        case OpCode::ALLOC:
+            return std::max(instr.op2, 0);
+        case OpCode::INV: case OpCode::NEG:
+            return 0;
+        case OpCode::DALLOC:
+            return -popped(instr);
+        default:
+            // binárias desempilham dois valores e empilham o resultado
+            return popped(instr) == 2 ? -1 : -popped(instr);
+    }
+}
+
+class Verifier {
+public:
+    Verifier(const DecodedInstruction* code, unsigned size)
+        : code(code), size(size), owner(size, 0), height(size, UNSEEN) {}
+
+    StackVerification run() {
+        this->contexts.push_back({0});
+        this->visit(MAIN, 0, 0);
+        while (!this->work.empty() && !this->uncertain) {
+            Item item = this->work.back();
+            this->work.pop_back();
+            this->step(item);
+        }
+
+        StackVerification result;
+        if (this->uncertain) {
+            return result;
+        }
+        if (!this->error.empty()) {
+            throw std::invalid_argument(this->error);
+        }
+        result.verified = true;
+        result.maxDepth = this->depth();
+        return result;
+    }
+
+private:
+    struct Item {
+        unsigned context;
+        unsigned address;
+        int64_t height;
+    };
+
+    struct Context {
+        unsigned entry;
+        bool returns = false;               // algum RETURN alcançável, com a pilha equilibrada
+        std::vector<Item> continuations;    // instruções após cada CALL para ele
+        std::vector<std::pair<unsigned, int64_t>> calls; // (procedimento, altura no CALL)
+        int64_t maxHeight = 0;
+        int state = 0;                      // em depth(): 0 novo, 1 em curso, 2 feito
+        int64_t maxDepth = 0;
+    };
+
+    const DecodedInstruction* code;
+    const unsigned size;
+
+    // A maioria dos endereços pertence a um único contexto: a primeira visita fica nos
+    // vetores e as visitas por outros contextos (código compartilhado) ficam no mapa
+    std::vector<unsigned> owner;
+    std::vector<int64_t> height;
+    std::unordered_map<uint64_t, int64_t> shared;
+
+    std::vector<Context> contexts;
+    std::unordered_map<unsigned, unsigned> contextOf; // endereço de entrada -> contexto
+    std::vector<Item> work;
+    bool uncertain = false;
+    std::string error;
+
+    int64_t& seen(unsigned context, unsigned address) {
+        if (this->height[address] == UNSEEN || this->owner[address] == context) {
+            this->owner[address] = context;
+            return this->height[address];
+        }
+        auto [it, inserted] = this->shared.try_emplace((uint64_t(context) << 32) | address, UNSEEN);
+        return it->second;
+    }
+
+    void visit(unsigned context, unsigned address, int64_t h) {
+        if (address >= this->size) {
+            return; // fim do programa: a execução para
+        }
+        int64_t& known = this->seen(context, address);
+        if (known == UNSEEN) {
+            known = h;
+            this->work.push_back({context, address, h});
+        } else if (known != h) {
+            this->uncertain = true; // alturas diferentes no mesmo ponto
+        }
+    }
+
+    unsigned procedure(unsigned entry) {
+        auto [it, inserted] = this->contextOf.try_emplace(entry, (unsigned)this->contexts.size());
+        if (inserted) {
+            this->contexts.push_back({entry});
+            this->visit(it->second, entry, 1);
+        }
+        return it->second;
+    }
+
+    // Checa se há valores suficientes; no programa principal a altura é exata e a falta é um
+    // erro certo. Num procedimento, tocar no endereço de retorno ou abaixo dele não é provável.
+    bool available(const Item& item, int64_t needed) {
+        const int64_t values = item.context == MAIN ? item.height : item.height - 1;
+        if (values >= needed) {
+            return true;
+        }
+        if (item.context != MAIN) {
+            this->uncertain = true;
+        } else if (this->error.empty()) {
+            const DecodedInstruction& instr = this->code[item.address];
+            this->error = std::string(Operations::getName(originalOpcode(instr.opcode))) + " no endereço " + std::to_string(item.address)
+                + " desempilha " + std::to_string(needed) + " valor(es), mas a pilha tem "
+                + std::to_string(values);
+        }
+        return false;
+    }
+
+    void step(Item item) {
+        Context& context = this->contexts[item.context];
+        DecodedInstruction instr = this->code[item.address];
+        instr.opcode = originalOpcode(instr.opcode); // as instruções originais seguem no programa
+
+        // num procedimento, o RETURN desempilha o próprio endereço de retorno (checado abaixo)
+        const bool ownReturn = instr.opcode == OpCode::RETURN && item.context != MAIN;
+        if (!this->available(item, ownReturn ? 0 : popped(instr))) {
+            return;
+        }
+        const int64_t next = item.height + effect(instr);
+        context.maxHeight = std::max({context.maxHeight, item.height, next});
+
+        switch (instr.opcode) {
+            case OpCode::HLT:
+            case OpCode::END:
+                return;
+            case OpCode::JMP:
+                this->visit(item.context, instr.op1, next);
+                return;
+            case OpCode::JMPF:
+                this->visit(item.context, instr.op1, next);
+                break;
+            case OpCode::CALL: {
+                const unsigned callee = this->procedure(instr.op1);
+                Item continuation{item.context, item.address + 1, item.height};
+                this->contexts[item.context].calls.push_back({callee, item.height});
+                this->contexts[callee].continuations.push_back(continuation);
+                if (this->contexts[callee].returns) {
+                    this->visit(continuation.context, continuation.address, continuation.height);
+                }
+                return;
+            }
+            case OpCode::RETURN:
+                // só o endereço empilhado pelo CALL pode estar no topo
+                if (item.context == MAIN || item.height != 1) {
+                    this->uncertain = true;
+                    return;
+                }
+                if (!context.returns) {
+                    context.returns = true;
+                    for (const Item& c : context.continuations) {
+                        this->visit(c.context, c.address, c.height);
+                    }
+                }
+                return;
+            default:
+                break;
+        }
+        this->visit(item.context, item.address + 1, next);
+    }
+
+    // Profundidade máxima de cada contexto acima da base de quem o chamou, em pós-ordem
+    // iterativa sobre o grafo de chamadas (cadeias longas não esgotam a pilha nativa);
+    // -1 se o contexto pode entrar numa recursão
+    int64_t depth() {
+        struct Frame {
+            unsigned id;
+            size_t next;    // próxima chamada a examinar
+            int64_t height; // altura no CALL que levou a este contexto
+        };
+        auto combine = [](Context& caller, const Context& callee, int64_t h) {
+            if (callee.state == 1 || callee.maxDepth < 0 || caller.maxDepth < 0) {
+                caller.maxDepth = -1;
+            } else {
+                caller.maxDepth = std::max(caller.maxDepth, h + callee.maxDepth);
+            }
+        };
+
+        std::vector<Frame> frames{{MAIN, 0, 0}};
+        this->contexts[MAIN].state = 1;
+        this->contexts[MAIN].maxDepth = this->contexts[MAIN].maxHeight;
+        while (!frames.empty()) {
+            Frame& frame = frames.back();
+            Context& context = this->contexts[frame.id];
+            if (frame.next < context.calls.size()) {
+                auto [callee, h] = context.calls[frame.next++];
+                Context& target = this->contexts[callee];
+                if (target.state == 0) {
+                    target.state = 1;
+                    target.maxDepth = target.maxHeight;
+                    frames.push_back({callee, 0, h});
+                } else {
+                    combine(context, target, h);
+                }
+                continue;
+            }
+            context.state = 2;
+            const int64_t h = frame.height;
+            frames.pop_back();
+            if (!frames.empty()) {
+                combine(this->contexts[frames.back().id], context, h);
+            }
+        }
+        return this->contexts[MAIN].maxDepth;
+    }
+};
+
+} // namespace
+
+StackVerification verifyStack(const DecodedInstruction* code, unsigned size) {
+    return Verifier(code, size).run();
+}
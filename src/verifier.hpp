@@ -0,0 +1,29 @@
+#ifndef VERIFIER_HPP
+#define VERIFIER_HPP
+
+#include <cstdint>
+#include "ops.hpp"
+
+// Resultado da verificação da pilha feita no carregamento
+struct StackVerification {
+    // true se a altura da pilha foi provada em todas as instruções alcançáveis e nenhuma
+    // desempilha mais valores do que há: os motores podem dispensar essas checagens
+    bool verified = false;
+
+    // Maior profundidade que a pilha pode atingir; -1 se não provada ou ilimitada (recursão)
+    int64_t maxDepth = -1;
+};
+
+// Interpretação abstrata da altura da pilha sobre o grafo de controle, a partir do START.
+// Cada procedimento (alvo de CALL) é analisado uma vez, com a altura relativa ao endereço de
+// retorno; um CALL continua na instrução seguinte com a mesma altura se o procedimento
+// retorna com a pilha equilibrada. ALLOC/DALLOC empilham/desempilham op2 valores.
+//
+// Lança std::invalid_argument se o programa certamente desempilha de uma pilha vazia no
+// programa principal (onde a altura é exata). Programas que a análise não consegue provar
+// (alturas diferentes num mesmo ponto, RETURN sem o endereço de retorno no topo, ...) não
+// são rejeitados: só continuam com as checagens em tempo de execução.
+// As superinstruções são analisadas como as instruções originais.
+StackVerification verifyStack(const DecodedInstruction* code, unsigned size);
+
+#endif // VERIFIER_HPP
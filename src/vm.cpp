@@ -1,75 +1,511 @@
 #include "vm.hpp"
 #include "ops.hpp"
+#include "stream_loader.hpp"
+#include "trace.hpp"
+#include <algorithm>
+#include <chrono>
 #include <iostream>
+#include <stdexcept>
 
 // Construtor da classe VirtualMachine
-VirtualMachine::VirtualMachine() {}
+VirtualMachine::VirtualMachine(size_t stackSize) : stack(stackSize) {}
 
 // Carregar instruções na memória da máquina virtual e verifica se a primeira instrucao é START
 void VirtualMachine::startVM(const std::vector<Instruction>& instructions) {
-    this->instructionMemory = instructions;
+    auto program = std::make_shared<Program>(instructions);
+    program->fuseSuperinstructions();
+    this->startVM(std::move(program));
+}
+
+void VirtualMachine::startVM(std::shared_ptr<const Program> program) {
+    // verifica se o programa comeca com a instrucao START (antes de alterar a VM: num erro,
+    // ela continua com o programa e o estado anteriores)
+    if (program->size() == 0 || program->code()[0].opcode != OpCode::START){
+        throw std::invalid_argument("O programa não começa com START");
+    }
+    this->checkAddresses(*program);
+
+    this->program = std::move(program);
+    this->streaming.reset();
 
     // setar os registradores
     this->start_sp = -1;
     this->sp = start_sp;
-    this->ip = 0;
+    this->ip = 1;
+    this->dispatches = 0;
+    this->stats = VMStats{};
+}
+
+void VirtualMachine::startVM(std::shared_ptr<StreamingProgram> program) {
+    // arquivo binário ou parsing já concluído: carregamento normal
+    if (std::shared_ptr<const Program> complete = program->program()) {
+        this->startVM(std::move(complete));
+        return;
+    }
 
-    // verifica se o programa comeca com a instrucao START
-    if (this->instructionMemory[0].operation != "START"){
+    const DecodedInstruction* first = program->instruction(0);
+    if (!first || first->opcode != OpCode::START) {
         throw std::invalid_argument("O programa não começa com START");
     }
-    this->ip++;
 
-    // inicializa as instrucoes
-    Operations::initialize();
+    this->program = nullptr;
+    this->streaming = std::move(program);
+    this->streamTargets.clear();
+    this->start_sp = -1;
+    this->sp = start_sp;
+    this->ip = 1;
+    this->dispatches = 0;
+    this->stats = VMStats{};
+}
+
+const Program& VirtualMachine::getProgram() const {
+    if (!this->program && this->streaming) {
+        return *this->streaming->wait();
+    }
+    return *this->program;
+}
 
-    // cria o label cache (label->endereco)
-    for (int i=0; i<this->instructionMemory.size(); i++){
-        const auto& instr = this->instructionMemory[i];
-        
-        if (instr.label){
-            this->label_cache[instr.label.value()] = i;
-        }
+void VirtualMachine::checkAddresses(const Program& p) const {
+    // endereços fixos fora da pilha pulariam as páginas de guarda
+    if (p.lowestAddress() <= p.highestAddress()
+        && (p.lowestAddress() < 0 || p.highestAddress() >= (int64_t)this->stack.size())) {
+        int64_t address = p.lowestAddress() < 0 ? p.lowestAddress() : p.highestAddress();
+        throw std::invalid_argument("O programa acessa o endereço " + std::to_string(address)
+            + ", fora da pilha (" + std::to_string(this->stack.size()) + " posições)");
     }
 }
 
+VMSnapshot VirtualMachine::snapshot() const {
+    if (this->streaming) {
+        throw std::runtime_error("Snapshot durante o carregamento em fluxo");
+    }
+    if (!this->program) {
+        throw std::runtime_error("Nenhum programa carregado");
+    }
+    if (this->status == ExecStatus::Running) {
+        throw std::runtime_error("Snapshot durante a execução");
+    }
+    return this->capture();
+}
+
+VMSnapshot VirtualMachine::capture() const {
+    VMSnapshot result;
+    result.program = this->program;
+    result.ip = this->ip;
+    result.sp = this->sp;
+    result.start_sp = this->start_sp;
+    result.dispatches = this->dispatches;
+    result.callDepth = this->stats.callDepth;
+    result.status = this->status;
+
+    // acima do topo, o programa só lê os endereços fixos (LDV, ALLOC); o resto só é
+    // alcançado por push, que escreve antes. Dos zeros do final nada precisa ser guardado.
+    const int64_t top = std::max<int64_t>({this->sp, this->stats.maxSp, this->program->highestAddress()});
+    size_t size = (size_t)std::min<int64_t>(top + 1, (int64_t)this->stack.size());
+    while (size > 0 && this->stack[size - 1] == 0) {
+        size--;
+    }
+    result.stack.assign(this->stack.begin(), this->stack.begin() + size);
+    return result;
+}
+
+void VirtualMachine::restore(const VMSnapshot& snapshot) {
+    if (snapshot.stack.size() > this->stack.size()) {
+        throw std::invalid_argument("O snapshot usa " + std::to_string(snapshot.stack.size())
+            + " posições da pilha, mas ela tem " + std::to_string(this->stack.size()));
+    }
+    this->checkAddresses(*snapshot.program);
+
+    this->program = snapshot.program;
+    this->streaming.reset();
+    this->stack.assign(snapshot.stack.data(), snapshot.stack.size());
+    this->ip = snapshot.ip;
+    this->sp = snapshot.sp;
+    this->start_sp = snapshot.start_sp;
+    this->dispatches = snapshot.dispatches;
+    this->stats.callDepth = snapshot.callDepth;
+    this->status = snapshot.status;
+}
+
+std::vector<std::unique_ptr<VirtualMachine>> VirtualMachine::fork(size_t count) const {
+    const VMSnapshot state = this->snapshot();
+    std::vector<std::unique_ptr<VirtualMachine>> children;
+    children.reserve(count);
+    for (size_t i = 0; i < count; i++) {
+        auto child = std::make_unique<VirtualMachine>(this->stack.size());
+        child->budget = this->budget;
+        child->restore(state);
+        children.push_back(std::move(child));
+    }
+    return children;
+}
+
+// VM executando na thread atual, para measuredRead/measuredWrite
+static thread_local VirtualMachine* measuredVM = nullptr;
+
 // Executar as instruções carregadas
-void VirtualMachine::execute(ReadFn readFn, WriteFn writeFn) {
-    this->readFn = readFn;
-    this->writeFn = writeFn;
+ExecStatus VirtualMachine::execute(ReadFn readFn, WriteFn writeFn, Engine engine) {
+    // os motores chamam os callbacks do host através de measuredRead/measuredWrite
+    this->hostRead = readFn;
+    this->hostWrite = writeFn;
+    this->readFn = measuredRead;
+    this->writeFn = measuredWrite;
+    this->status = ExecStatus::Running;
+    this->limit = this->budget ? this->dispatches + this->budget : UINT64_MAX;
+
+    VirtualMachine* previous = measuredVM;
+    measuredVM = this;
+    const auto start = std::chrono::steady_clock::now();
+
+    struct Run {
+        VirtualMachine* vm;
+        Engine engine;
+    } run{this, engine};
+    bool inBounds;
+    try {
+        inBounds = this->stack.runGuarded([](void* context) {
+            Run& run = *static_cast<Run*>(context);
+            run.vm->dispatch(run.engine);
+        }, &run);
+    } catch (...) {
+        measuredVM = previous;
+        this->stats.runNanoseconds += std::chrono::nanoseconds(std::chrono::steady_clock::now() - start).count();
+        throw;
+    }
+    measuredVM = previous;
+    this->stats.runNanoseconds += std::chrono::nanoseconds(std::chrono::steady_clock::now() - start).count();
+    this->stats.frameTop(this->sp);
+
+    if (!inBounds) {
+        // os registradores podem não refletir o ponto exato do acesso
+        this->status = ExecStatus::Halted;
+        throw std::runtime_error("Acesso fora da pilha (" + std::to_string(this->stack.size()) + " posições)");
+    }
+
+    if (this->status == ExecStatus::Running) {
+        this->status = ExecStatus::Halted;
+    } else {
+        this->ip = this->resumeIp;
+    }
+    return this->status;
+}
+
+void VirtualMachine::dispatch(Engine engine) {
+    if (this->streaming && !this->executeStreaming()) {
+        return;
+    }
+    if (this->profiler || this->tracer) {
+        this->executeTable();
+        return;
+    }
+#ifdef VM_HAS_JIT
+    if (engine == Engine::Jit) {
+        this->executeJit();
+        return;
+    }
+#endif
+#ifdef VM_HAS_THREADED_DISPATCH
+    if (engine == Engine::Threaded || engine == Engine::Jit) {
+        this->executeThreaded();
+        return;
+    }
+#endif
+    this->executeTable();
+}
+
+// Com a pilha do programa provada no carregamento, faltar valores só seria possível com um
+// endereço de retorno sobrescrito por STR/DALLOC; mesmo aí o acesso abaixo da base cai na
+// página de guarda, então a checagem só é dispensada com a pilha protegida
+bool VirtualMachine::checked() const {
+#ifdef VM_HAS_GUARDED_STACK
+    return !this->program->stackVerified();
+#else
+    return true;
+#endif
+}
+
+// VM usando os buffers na thread atual (os callbacks de E/S não recebem contexto)
+static thread_local VirtualMachine* bufferedVM = nullptr;
+
+ExecStatus VirtualMachine::execute(IOBuffers& io, Engine engine) {
+    VirtualMachine* previous = bufferedVM;
+    bufferedVM = this;
+    this->io = &io;
+
+    try {
+        this->execute(bufferedRead, bufferedWrite, engine);
+    } catch (...) {
+        bufferedVM = previous;
+        this->io = nullptr;
+        throw;
+    }
+
+    bufferedVM = previous;
+    this->io = nullptr;
+    return this->status;
+}
+
+// Ler o relógio custa mais que um callback em buffer: as primeiras IO_SAMPLE chamadas de E/S
+// são cronometradas, e depois uma a cada IO_SAMPLE, com o tempo multiplicado por IO_SAMPLE
+constexpr uint64_t IO_SAMPLE = 64;
+
+template <typename Call>
+static void timeIO(VMStats& stats, Call call) {
+    const uint64_t calls = stats.reads + stats.writes;
+    if (calls >= IO_SAMPLE && calls % IO_SAMPLE != 0) {
+        call();
+        return;
+    }
+    const auto start = std::chrono::steady_clock::now();
+    call();
+    const uint64_t elapsed = std::chrono::nanoseconds(std::chrono::steady_clock::now() - start).count();
+    stats.ioNanoseconds += calls >= IO_SAMPLE ? elapsed * IO_SAMPLE : elapsed;
+}
+
+int VirtualMachine::measuredRead() {
+    VirtualMachine& vm = *measuredVM;
+    int value = 0;
+    timeIO(vm.stats, [&] { value = vm.hostRead(); });
+    if (vm.status == ExecStatus::Running) vm.stats.reads++;
+    return value;
+}
 
-    while (this->ip < this->instructionMemory.size()) {
-        const auto& instr = this->instructionMemory[this->ip];
+void VirtualMachine::measuredWrite(int value) {
+    VirtualMachine& vm = *measuredVM;
+    timeIO(vm.stats, [&] { vm.hostWrite(value); });
+    if (vm.status == ExecStatus::Running) vm.stats.writes++;
+}
+
+int VirtualMachine::bufferedRead() {
+    VirtualMachine& vm = *bufferedVM;
+    IOBuffers& io = *vm.io;
+
+    if (io.inputUsed >= io.inputSize) {
+        vm.status = ExecStatus::NeedsInput;
+        return 0;
+    }
+    return io.input[io.inputUsed++];
+}
+
+void VirtualMachine::bufferedWrite(int value) {
+    VirtualMachine& vm = *bufferedVM;
+    IOBuffers& io = *vm.io;
+
+    if (io.outputSize >= io.outputCapacity) {
+        if (!io.flush || io.outputSize == 0) {
+            vm.status = ExecStatus::OutputFull;
+            return;
+        }
+        io.flush(io.output, io.outputSize, io.user);
+        io.outputSize = 0;
+    }
+    io.output[io.outputSize++] = value;
+}
+
+// Interrompe o motor em execução: ip fica fora do programa (o laço termina) e volta
+// para address ao final de execute()
+void VirtualMachine::suspend(int address) {
+    this->resumeIp = address;
+    this->ip = -1;
+}
+
+// Motor de referência: despacho pela tabela de ponteiros de função
+void VirtualMachine::executeTable() {
+    const bool budgeted = this->limit != UINT64_MAX;
+    if (this->profiler || this->tracer) {
+        budgeted ? this->runTable<true, true>() : this->runTable<false, true>();
+    } else {
+        budgeted ? this->runTable<true, false>() : this->runTable<false, false>();
+    }
+}
+
+template <bool Budgeted, bool Instrumented>
+void VirtualMachine::runTable() {
+    const DecodedInstruction* code = this->program->code();
+    const unsigned size = this->program->size();
+
+    while ((unsigned)this->ip < size) {
+        if (Budgeted && this->dispatches >= this->limit) {
+            this->status = ExecStatus::BudgetExhausted;
+            this->suspend(this->ip);
+            break;
+        }
+        if constexpr (Instrumented) {
+            if (this->tracer && this->tracer->checkpointDue(this->dispatches)) {
+                this->tracer->checkpoint(this->capture());
+            }
+        }
+
+        const DecodedInstruction& instr = code[this->ip];
+        const unsigned address = this->ip;
         this->ip++; // Avançar o Instruction Pointer
+        this->dispatches++;
 
-        if (!instr.operation.empty()) {
-            // std::cout << "Executando operação: " << instr.operation << std::endl;
-            if (instr.operation == "HLT"){
-                break;
-            } else if (instr.operation == "DEBUG"){
-                this->debug();
-                continue;
+        if (instr.opcode == OpCode::HLT){
+            if constexpr (Instrumented) {
+                if (this->profiler) this->profiler->onInstruction(address, instr.opcode);
             }
+            break;
+        }
+
+        Operations::getOperation(instr.opcode)(*this, instr);
 
-            Operation op = Operations::getOperation(instr.operation);
-            
-            // operadores string
-            if (instr.operation == "JMP" || instr.operation == "JMPF" || instr.operation == "CALL"){
-                op(*this, instr.op1.value(), instr.op2.value_or(""));
+        // pilha sombra: CALL entra no procedimento alvo, RETURN sai do atual
+        // (com a E/S bloqueada, a instrução é refeita depois e só conta então)
+        if constexpr (Instrumented) {
+            if (this->status == ExecStatus::Running && this->profiler) {
+                this->profiler->onInstruction(address, instr.opcode);
+                if (instr.opcode == OpCode::CALL || instr.opcode == OpCode::CALL_ALLOC) {
+                    this->profiler->onCall(instr.op1);
+                } else if (instr.opcode == OpCode::RETURN || instr.opcode == OpCode::DALLOC_RETURN) {
+                    this->profiler->onReturn();
+                }
             }
-            else { // operadores int
-                int op1, op2;
-                if (instr.op1) op1 = std::stoi(instr.op1.value());
-                if (instr.op2) op2 = std::stoi(instr.op2.value());
+            if (this->status == ExecStatus::Running && this->tracer) {
+                this->tracer->onInstruction(this->dispatches, address, instr.opcode, this->ip,
+                                            instr.opcode == OpCode::RD ? this->stack[this->sp] : 0);
+            }
+        }
+    }
+}
 
-                op(*this, op1, op2);
+// Carregamento em fluxo: as instruções já publicadas executam pelas operações da tabela.
+// Os desvios guardam o símbolo do label, resolvido na primeira vez que é preciso; os
+// endereços fixos são conferidos a cada instrução, já que o programa ainda não foi visto
+// inteiro. Quando o programa completo fica pronto, a execução segue nele. Como os demais
+// motores, roda dentro de runGuarded: nenhum objeto com destrutor fica vivo durante as
+// operações (o cache dos destinos é da VM).
+bool VirtualMachine::executeStreaming() {
+    StreamingProgram& source = *this->streaming;
+    std::vector<int32_t>& targets = this->streamTargets;
+
+    while (this->ip >= 0) {
+        if (std::shared_ptr<const Program> complete = source.program()) {
+            this->checkAddresses(*complete);
+            this->program = std::move(complete);
+            this->streaming.reset();
+            return true;
+        }
+        if (this->dispatches >= this->limit) {
+            this->status = ExecStatus::BudgetExhausted;
+            this->suspend(this->ip);
+            return false;
+        }
+
+        const DecodedInstruction* instr = source.instruction(this->ip);
+        if (!instr) {
+            continue; // fim do texto: o programa completo já está pronto
+        }
+
+        int64_t first = 0, last = -1;
+        switch (instr->opcode) {
+            case OpCode::LDV:
+            case OpCode::STR:
+                first = last = instr->op1;
+                break;
+            case OpCode::ALLOC:
+            case OpCode::DALLOC:
+                first = instr->op1;
+                last = (int64_t)instr->op1 + instr->op2 - 1;
+                break;
+            default:
+                break;
+        }
+        if (first <= last && (first < 0 || last >= (int64_t)this->stack.size())) {
+            throw std::invalid_argument("O programa acessa o endereço " + std::to_string(first < 0 ? first : last)
+                + ", fora da pilha (" + std::to_string(this->stack.size()) + " posições)");
+        }
+
+        this->ip++;
+        this->dispatches++;
+        if (instr->opcode == OpCode::HLT) {
+            return false;
+        }
+
+        // JMPF que não desvia não precisa do destino (e não espera pelo label)
+        const bool jumps = Operations::takesLabel(instr->opcode)
+            && !(instr->opcode == OpCode::JMPF && this->sp > this->start_sp && this->stack[this->sp] != 0);
+        if (jumps) {
+            DecodedInstruction resolved = *instr;
+            if ((size_t)instr->op1 >= targets.size()) {
+                targets.resize(instr->op1 + 1, -1);
+            }
+            if (targets[instr->op1] < 0) {
+                targets[instr->op1] = source.resolve(instr->op1);
             }
+            resolved.op1 = targets[instr->op1];
+            Operations::getOperation(resolved.opcode)(*this, resolved);
+        } else {
+            Operations::getOperation(instr->opcode)(*this, *instr);
+        }
+    }
+    return false;
+}
 
-        } else if (instr.label) {
-            // std::cout << "Executando Label: " << *instr.label << std::endl;
+bool VirtualMachine::step() {
+    const DecodedInstruction& instr = this->program->code()[this->ip];
+    this->ip++;
+    this->dispatches++;
+
+    if (instr.opcode == OpCode::HLT) {
+        return false;
+    }
+
+    Operations::getOperation(instr.opcode)(*this, instr);
+    return true;
+}
+
+#ifdef VM_HAS_JIT
+// Código nativo; DEBUG, erros de execução e instruções não traduzidas voltam para o
+// motor de referência por uma instrução, depois a execução nativa continua
+void VirtualMachine::executeJit() {
+    const JitCode& jit = this->program->jit(this->limit != UINT64_MAX);
+    const unsigned size = this->program->size();
+
+    JitContext context{};
+    context.stack = this->stack.data();
+    context.entries = jit.entries();
+    context.vmIp = &this->ip;
+    context.vmSp = &this->sp;
+    context.readFn = this->readFn;
+    context.writeFn = this->writeFn;
+    context.minUnary = this->start_sp;
+    context.minBinary = this->start_sp + 1;
+    context.status = &this->status;
+    context.limit = this->limit;
+    context.stackSize = this->stack.size();
+
+    while ((unsigned)this->ip < size) {
+        context.ip = this->ip;
+        context.sp = this->sp;
+        context.dispatches = this->dispatches;
+        context.callDepth = this->stats.callDepth;
+        context.maxCallDepth = this->stats.maxCallDepth;
+        context.maxSp = this->stats.maxSp;
+
+        JitExit exit = jit.run(context);
+
+        this->ip = context.ip;
+        this->sp = context.sp;
+        this->dispatches = context.dispatches;
+        this->stats.callDepth = context.callDepth;
+        this->stats.maxCallDepth = context.maxCallDepth;
+        this->stats.maxSp = context.maxSp;
+
+        if (exit == JitExit::Budget) {
+            this->status = ExecStatus::BudgetExhausted;
+        }
+        if (this->status != ExecStatus::Running) {
+            this->suspend(this->ip);
+            break;
+        }
+
+        if (exit == JitExit::Halted || !this->step()) {
+            break;
         }
     }
 }
+#endif
 
 // Função para depurar o estado interno da máquina virtual
 void VirtualMachine::debug() {
@@ -77,15 +513,12 @@ void VirtualMachine::debug() {
     std::cout << "Instruction Pointer: " << ip << "\n";
     std::cout << "Stack Pointer: " << sp << "\n";
     std::cout << "Stack Memory: ";
-    std::array<int, 8192> tempStack = this->stack;
-    int tempSp = this->sp;
-    while (tempSp >= 0) {
-        std::cout << tempStack[tempSp] << " ";
-        tempSp--;
+    for (int i = this->sp; i >= 0; i--) {
+        std::cout << this->stack[i] << " ";
     }
     std::cout << "\n";
 
-    auto currInst = this->instructionMemory[this->ip];
-    std::cout << currInst.label.value_or("") << " " << currInst.operation << " " << currInst.op1.value_or("") << "," << currInst.op2.value_or("");
-    
+    if (this->program) {
+        std::cout << this->program->describeInstruction(this->ip);
+    }
 }
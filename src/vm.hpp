@@ -1,42 +1,175 @@
-#include <optional>
-#include <unordered_map>
-#include <string>
+#ifndef VM_HPP
+#define VM_HPP
+
+#include <cstdint>
+#include <memory>
 #include <vector>
-#include <array>
-
-// Estrutura para armazenar uma instrução
-struct Instruction {
-    std::optional<std::string> label;
-    std::string operation;
-    std::optional<std::string> op1;
-    std::optional<std::string> op2;
+#include "jit.hpp"
+#include "profiler.hpp"
+#include "program.hpp"
+#include "vm_stack.hpp"
+
+// O despacho por computed goto depende da extensão "labels as values" do GCC/Clang
+#if defined(__GNUC__) && !defined(VM_NO_THREADED_DISPATCH)
+#define VM_HAS_THREADED_DISPATCH 1
+#endif
+
+// Motores de execução disponíveis
+enum class Engine {
+    Table,    // tabela de ponteiros de função (Operations), sempre disponível
+    Threaded, // computed goto com todas as operações no mesmo laço
+    Jit,      // código nativo x86-64 (jit.hpp); sem suporte, usa o motor padrão abaixo
 };
 
-typedef int(*ReadFn)();
-typedef void(*WriteFn)(int);
+#ifdef VM_HAS_THREADED_DISPATCH
+constexpr Engine DEFAULT_ENGINE = Engine::Threaded;
+#else
+constexpr Engine DEFAULT_ENGINE = Engine::Table;
+#endif
 
-#ifndef VM_HPP
-#define VM_HPP
+// Resultado de execute()
+enum class ExecStatus : int32_t {
+    Halted,     // HLT, fim do programa ou RETURN para fora dele
+    NeedsInput, // RD sem valor disponível; ip aponta para o RD
+    OutputFull, // PRN sem espaço na saída; ip aponta para o PRN
+    BudgetExhausted, // executou `budget` instruções; ip aponta para a próxima
+    Running,    // durante a execução
+};
+
+// E/S em buffers: RD consome input e PRN escreve em output sem chamar o host a cada valor.
+// Com a saída cheia, flush (se houver) recebe os valores e outputSize volta a 0; sem flush,
+// execute() retorna OutputFull. Sem entrada, retorna NeedsInput. Nos dois casos a execução
+// continua da mesma instrução na próxima chamada, depois que o host atualizar os buffers.
+struct IOBuffers {
+    const int* input = nullptr;
+    size_t inputSize = 0;
+    size_t inputUsed = 0;
+
+    int* output = nullptr;
+    size_t outputCapacity = 0;
+    size_t outputSize = 0;
+
+    void (*flush)(const int* values, size_t count, void* user) = nullptr;
+    void* user = nullptr;
+};
+
+// Estado de uma VM pausada (fora de execute()): registradores e o trecho da pilha que já
+// foi tocado, sem os zeros do final. Imutável depois de criado: um mesmo snapshot pode ser
+// restaurado em várias VMs, inclusive em threads diferentes, e o programa é compartilhado.
+struct VMSnapshot {
+    std::shared_ptr<const Program> program;
+    int ip = 0;
+    int sp = -1;
+    int start_sp = -1;
+    uint64_t dispatches = 0;
+    int64_t callDepth = 0;
+    ExecStatus status = ExecStatus::Halted;
+    std::vector<int> stack; // posições [0, stack.size()); as demais valem zero
+};
+
+// Métricas sempre ligadas, acumuladas desde startVM; o número de instruções executadas é
+// VirtualMachine::dispatches. Os motores só as atualizam em CALL, ALLOC e RETURN, e execute()
+// conta a E/S e o tempo: a altura da pilha é amostrada depois de cada CALL/ALLOC e ao fim de
+// cada execute(), sem os valores temporários das expressões entre esses pontos.
+struct VMStats {
+    int64_t callDepth = 0;        // CALLs sem o RETURN correspondente (faz parte dos snapshots)
+    int64_t maxCallDepth = 0;
+    int64_t maxSp = -1;           // maior sp amostrado
+    uint64_t reads = 0;           // RDs concluídos
+    uint64_t writes = 0;          // PRNs concluídos
+    uint64_t ioNanoseconds = 0;   // dentro de readFn/writeFn (estimado por amostragem)
+    uint64_t runNanoseconds = 0;  // dentro de execute(), com a E/S
+
+    void enterCall() {
+        if (++this->callDepth > this->maxCallDepth) this->maxCallDepth = this->callDepth;
+    }
+    void frameTop(int64_t sp) {
+        if (sp > this->maxSp) this->maxSp = sp;
+    }
+};
+
+class StreamingProgram;
+class Tracer;
 
 class VirtualMachine {
 private:
-    std::vector<Instruction> instructionMemory; // Memória para armazenar as instruções
+    std::shared_ptr<const Program> program; // Programa em execução (compartilhável entre VMs)
+    std::shared_ptr<StreamingProgram> streaming; // carregamento em fluxo, até o programa ficar completo
+    std::vector<int32_t> streamTargets;          // destinos já resolvidos, por id de símbolo (-1: não)
+    IOBuffers* io = nullptr;                // buffers da execução atual (execute com IOBuffers)
+    ReadFn hostRead = nullptr;              // callbacks passados a execute(), chamados pelos
+    WriteFn hostWrite = nullptr;            // de readFn/writeFn, que medem a E/S
+    int resumeIp = 0;
+    uint64_t limit = UINT64_MAX; // valor de dispatches em que a execução atual para
+
+    static int bufferedRead();
+    static void bufferedWrite(int value);
+    static int measuredRead();
+    static void measuredWrite(int value);
+
+    void dispatch(Engine engine);
+    void executeTable();
+    void executeThreaded();
+    void executeJit();
+    bool executeStreaming(); // true quando o programa completo fica pronto (segue nele)
+    bool step(); // executa uma instrução pelo motor de referência; false em HLT
+    template <bool Budgeted, bool Instrumented> void runTable();
+    template <bool Direct, bool Budgeted, bool Checked> void runThreaded();
+    bool checked() const; // false se o programa pode rodar sem checar valores insuficientes
+    void checkAddresses(const Program& program) const; // endereços fixos dentro da pilha
+    VMSnapshot capture() const;  // snapshot sem checar o estado (checkpoints durante a execução)
 
 public:
-    VirtualMachine();
-    
-    std::unordered_map<std::string, int> label_cache;
-    std::array<int, 8192> stack = {}; // Stack
+    explicit VirtualMachine(size_t stackSize = DEFAULT_STACK_SIZE);
 
-    int ip; // Instruction Pointer
-    int sp; // Stack Pointer
-    int start_sp;
+    VMStack stack; // Stack (acesso fora dela vira erro de execução, ver vm_stack.hpp)
+
+    int ip = 0; // Instruction Pointer
+    int sp = -1; // Stack Pointer
+    int start_sp = -1;
+
+    uint64_t dispatches = 0; // instruções despachadas (uma superinstrução conta como uma)
+    uint64_t budget = 0;     // máximo de instruções por chamada de execute() (0: sem limite)
+    VMStats stats;
+
+    // Com um profiler (não pertence à VM), execute() usa a variante instrumentada do motor
+    // de tabela, qualquer que seja o motor pedido
+    Profiler* profiler = nullptr;
+
+    // Com um tracer (não pertence à VM), a execução é gravada (trace.hpp), também pelo motor
+    // de tabela instrumentado
+    Tracer* tracer = nullptr;
 
     ReadFn readFn;
     WriteFn writeFn;
 
+    // Running durante a execução; o callback de E/S o altera quando não pode prosseguir,
+    // e RD/PRN chamam suspend() com o próprio endereço, para serem executados de novo depois
+    ExecStatus status = ExecStatus::Halted;
+    void suspend(int address);
+
     void startVM(const std::vector<Instruction>& instructions);
-    void execute(ReadFn, WriteFn);
+    // Lança std::invalid_argument (sem alterar a VM) se o programa não começa com START ou
+    // acessa endereços fixos fora da pilha
+    void startVM(std::shared_ptr<const Program> program);
+    // Começa a executar enquanto o parsing continua (stream_loader.hpp); snapshot, restore e
+    // fork só ficam disponíveis depois que o programa completo é adotado
+    void startVM(std::shared_ptr<StreamingProgram> program);
+    // No carregamento em fluxo, espera o programa completo
+    const Program& getProgram() const;
+
+    // Captura o estado para reexecutar a partir deste ponto (por exemplo, parado em
+    // NeedsInput, com entradas diferentes). Copia a pilha até o topo, a maior altura
+    // registrada (VMStats::maxSp) ou o maior endereço fixo do programa, o que for maior.
+    VMSnapshot snapshot() const;
+    // Volta ao estado capturado; a pilha desta VM precisa comportar o programa do snapshot
+    void restore(const VMSnapshot& snapshot);
+    // count VMs novas no estado atual desta, com o mesmo tamanho de pilha e budget, para
+    // explorar entradas diferentes em paralelo (cada uma em uma thread)
+    std::vector<std::unique_ptr<VirtualMachine>> fork(size_t count) const;
+
+    ExecStatus execute(ReadFn, WriteFn, Engine engine = DEFAULT_ENGINE);
+    ExecStatus execute(IOBuffers& io, Engine engine = DEFAULT_ENGINE);
     void debug(); // Para depuração e visualização do estado interno
     
 };
@@ -0,0 +1,430 @@
+#include "vm_api.hpp"
+#include <algorithm>
+#include <chrono>
+#include <exception>
+#include <fstream>
+#include <memory>
+#include <iostream>
+#include <string>
+#include "batch.hpp"
+#include "loader.hpp"
+#include "program_cache.hpp"
+#include "trace.hpp"
+#include "vm.hpp"
+
+struct vm_instance {
+    explicit vm_instance(size_t stackSize) : machine(stackSize) {}
+
+    VirtualMachine machine;
+    Engine engine = DEFAULT_ENGINE;
+    bool loaded = false;
+    std::string error;
+    std::vector<int> snapshot; // pilha no último vm_get_state (para a faixa alterada)
+    std::unique_ptr<Profiler> profiler;
+    std::unique_ptr<Tracer> tracer;
+    uint64_t checkpointInterval = DEFAULT_CHECKPOINT_INTERVAL;
+    size_t traceCapacity = 0;
+};
+
+struct vm_snapshot {
+    VMSnapshot state;
+};
+
+static thread_local vm_t* current = nullptr;
+
+// instruções executadas entre duas consultas ao relógio em vm_run com prazo
+constexpr uint64_t DEADLINE_SLICE = 1 << 16;
+
+extern "C" {
+
+vm_t* vm_create(void) {
+    return vm_create_with_stack(DEFAULT_STACK_SIZE);
+}
+
+vm_t* vm_create_with_stack(size_t stack_size) {
+    try {
+        return new vm_instance(stack_size);
+    } catch (const std::exception&) {
+        return nullptr;
+    }
+}
+
+void vm_destroy(vm_t* vm) {
+    delete vm;
+}
+
+int vm_load(vm_t* vm, const char* file_path) {
+    try {
+        // num erro de carga, a instância continua com o programa e a pilha anteriores
+        std::shared_ptr<const Program> program = programCache().load(file_path);
+        vm->machine.startVM(std::move(program));
+        vm->machine.stack.clear(); // a pilha começa zerada, como numa instância nova
+        vm->loaded = true;
+        vm->error.clear();
+        if (vm->profiler) {
+            // o perfil anterior era de outro programa
+            vm->profiler = std::make_unique<Profiler>();
+            vm->machine.profiler = vm->profiler.get();
+        }
+        if (vm->tracer) {
+            vm->tracer = std::make_unique<Tracer>(vm->checkpointInterval, vm->traceCapacity);
+            vm->machine.tracer = vm->tracer.get();
+        }
+        return VM_OK;
+    } catch (const std::exception& ex) {
+        vm->error = ex.what();
+        return VM_ERROR;
+    }
+}
+
+int vm_set_engine(vm_t* vm, int engine) {
+    switch (engine) {
+        case VM_ENGINE_TABLE:
+            vm->engine = Engine::Table;
+            return VM_OK;
+#ifdef VM_HAS_THREADED_DISPATCH
+        case VM_ENGINE_THREADED:
+            vm->engine = Engine::Threaded;
+            return VM_OK;
+#endif
+#ifdef VM_HAS_JIT
+        case VM_ENGINE_JIT:
+            vm->engine = Engine::Jit;
+            return VM_OK;
+#endif
+        default:
+            vm->error = "Motor indisponível: " + std::to_string(engine);
+            return VM_ERROR;
+    }
+}
+
+int vm_execute(vm_t* vm, vm_read_fn read_fn, vm_write_fn write_fn) {
+    if (!vm->loaded) {
+        vm->error = "Nenhum programa carregado";
+        return VM_ERROR;
+    }
+
+    vm_t* previous = current;
+    current = vm;
+    int status = VM_OK;
+    try {
+        vm->machine.execute(read_fn, write_fn, vm->engine);
+        vm->error.clear();
+    } catch (const std::exception& ex) {
+        vm->error = ex.what();
+        status = VM_ERROR;
+    }
+    current = previous;
+    return status;
+}
+
+int vm_execute_io(vm_t* vm, vm_io* io) {
+    return vm_run(vm, io, 0, 0);
+}
+
+int vm_run(vm_t* vm, vm_io* io, uint64_t max_instructions, uint64_t timeout_us) {
+    if (!vm->loaded) {
+        vm->error = "Nenhum programa carregado";
+        return VM_ERROR;
+    }
+
+    IOBuffers buffers;
+    if (io) {
+        buffers.input = io->input;
+        buffers.inputSize = io->input_size;
+        buffers.inputUsed = io->input_used;
+        buffers.output = io->output;
+        buffers.outputCapacity = io->output_capacity;
+        buffers.outputSize = io->output_size;
+        buffers.flush = io->flush;
+        buffers.user = io->user;
+    }
+
+    // com prazo, executa em fatias e confere o relógio entre elas
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::microseconds(timeout_us);
+    uint64_t remaining = max_instructions;
+
+    vm_t* previous = current;
+    current = vm;
+    int status = VM_OK;
+    try {
+        for (;;) {
+            uint64_t slice = remaining;
+            if (timeout_us && (!slice || slice > DEADLINE_SLICE)) {
+                slice = DEADLINE_SLICE;
+            }
+
+            const uint64_t before = vm->machine.dispatches;
+            vm->machine.budget = slice;
+            ExecStatus result = vm->machine.execute(buffers, vm->engine);
+            vm->machine.budget = 0;
+
+            if (result != ExecStatus::BudgetExhausted) {
+                status = result == ExecStatus::NeedsInput ? VM_NEEDS_INPUT
+                       : result == ExecStatus::OutputFull ? VM_OUTPUT_FULL
+                       : VM_OK;
+                break;
+            }
+            if (remaining) {
+                remaining -= std::min(remaining, vm->machine.dispatches - before);
+                if (!remaining) {
+                    status = VM_BUDGET_EXHAUSTED;
+                    break;
+                }
+            }
+            if (timeout_us && std::chrono::steady_clock::now() >= deadline) {
+                status = VM_BUDGET_EXHAUSTED;
+                break;
+            }
+        }
+        vm->error.clear();
+    } catch (const std::exception& ex) {
+        vm->machine.budget = 0;
+        vm->error = ex.what();
+        status = VM_ERROR;
+    }
+    current = previous;
+
+    if (io) {
+        io->input_used = buffers.inputUsed;
+        io->output_size = buffers.outputSize;
+    }
+    return status;
+}
+
+int vm_get_ip(const vm_t* vm) {
+    return vm->machine.ip;
+}
+
+int vm_get_sp(const vm_t* vm) {
+    return vm->machine.sp;
+}
+
+int vm_get_stack(const vm_t* vm, int index) {
+    if (index < 0 || (size_t)index >= vm->machine.stack.size()) {
+        return 0;
+    }
+    return vm->machine.stack[index];
+}
+
+const int* vm_stack_view(const vm_t* vm, size_t* length) {
+    *length = vm->machine.stack.size();
+    return vm->machine.stack.data();
+}
+
+void vm_get_state(vm_t* vm, vm_state* state) {
+    const auto& stack = vm->machine.stack;
+    state->ip = vm->machine.ip;
+    state->sp = vm->machine.sp;
+    state->start_sp = vm->machine.start_sp;
+    state->instructions = vm->machine.dispatches;
+    state->stack = stack.data();
+    state->stack_size = stack.size();
+
+    // faixa alterada: compara com a cópia do último estado (nada é rastreado durante a execução)
+    if (vm->snapshot.size() != stack.size()) {
+        vm->snapshot.assign(stack.begin(), stack.end());
+        state->dirty_begin = 0;
+        state->dirty_end = stack.size();
+        return;
+    }
+    auto first = std::mismatch(stack.begin(), stack.end(), vm->snapshot.begin()).first;
+    if (first == stack.end()) {
+        state->dirty_begin = state->dirty_end = stack.size();
+        return;
+    }
+    auto last = std::mismatch(std::make_reverse_iterator(stack.end()), std::make_reverse_iterator(stack.begin()),
+                              vm->snapshot.rbegin()).first.base();
+    state->dirty_begin = first - stack.begin();
+    state->dirty_end = last - stack.begin();
+    std::copy(first, last, vm->snapshot.begin() + state->dirty_begin);
+}
+
+void vm_get_stats(const vm_t* vm, vm_stats* stats) {
+    const VMStats& current = vm->machine.stats;
+    stats->instructions = vm->machine.dispatches;
+    stats->call_depth = current.callDepth;
+    stats->max_call_depth = current.maxCallDepth;
+    stats->stack_high_water = (size_t)(current.maxSp + 1);
+    stats->reads = current.reads;
+    stats->writes = current.writes;
+    stats->io_ns = current.ioNanoseconds;
+    stats->compute_ns = current.runNanoseconds - std::min(current.ioNanoseconds, current.runNanoseconds);
+}
+
+const char* vm_last_error(const vm_t* vm) {
+    return vm->error.c_str();
+}
+
+vm_snapshot_t* vm_snapshot(vm_t* vm) {
+    if (!vm->loaded) {
+        vm->error = "Nenhum programa carregado";
+        return nullptr;
+    }
+    try {
+        return new vm_snapshot_t{vm->machine.snapshot()};
+    } catch (const std::exception& ex) {
+        vm->error = ex.what();
+        return nullptr;
+    }
+}
+
+int vm_restore(vm_t* vm, const vm_snapshot_t* snapshot) {
+    try {
+        vm->machine.restore(snapshot->state);
+        vm->loaded = true;
+        vm->error.clear();
+        return VM_OK;
+    } catch (const std::exception& ex) {
+        vm->error = ex.what();
+        return VM_ERROR;
+    }
+}
+
+void vm_snapshot_destroy(vm_snapshot_t* snapshot) {
+    delete snapshot;
+}
+
+int vm_fork(vm_t* vm, vm_t** children, size_t count) {
+    if (!vm->loaded) {
+        vm->error = "Nenhum programa carregado";
+        return VM_ERROR;
+    }
+    std::vector<std::unique_ptr<vm_instance>> created;
+    try {
+        const VMSnapshot state = vm->machine.snapshot();
+        for (size_t i = 0; i < count; i++) {
+            auto child = std::make_unique<vm_instance>(vm->machine.stack.size());
+            child->engine = vm->engine;
+            child->machine.restore(state);
+            child->loaded = true;
+            created.push_back(std::move(child));
+        }
+    } catch (const std::exception& ex) {
+        vm->error = ex.what();
+        return VM_ERROR;
+    }
+    for (size_t i = 0; i < count; i++) {
+        children[i] = created[i].release();
+    }
+    return VM_OK;
+}
+
+void vm_set_profiling(vm_t* vm, int enabled) {
+    if (enabled && !vm->profiler) {
+        vm->profiler = std::make_unique<Profiler>();
+    } else if (!enabled) {
+        vm->profiler.reset();
+    }
+    vm->machine.profiler = vm->profiler.get();
+}
+
+int vm_write_profile(vm_t* vm, const char* report_path, const char* folded_path) {
+    if (!vm->profiler || !vm->loaded) {
+        vm->error = "Perfil desligado ou nenhum programa carregado";
+        return VM_ERROR;
+    }
+    std::ofstream report, folded;
+    if (report_path) {
+        report.open(report_path);
+        vm->profiler->writeReport(report, vm->machine.getProgram());
+    }
+    if (folded_path) {
+        folded.open(folded_path);
+        vm->profiler->writeFolded(folded, vm->machine.getProgram());
+    }
+    if ((report_path && !report) || (folded_path && !folded)) {
+        vm->error = "Não foi possível gravar o perfil";
+        return VM_ERROR;
+    }
+    return VM_OK;
+}
+
+void vm_set_tracing(vm_t* vm, int enabled, uint64_t checkpoint_interval, size_t capacity) {
+    vm->checkpointInterval = checkpoint_interval ? checkpoint_interval : DEFAULT_CHECKPOINT_INTERVAL;
+    vm->traceCapacity = capacity;
+    if (enabled) {
+        vm->tracer = std::make_unique<Tracer>(vm->checkpointInterval, vm->traceCapacity);
+    } else {
+        vm->tracer.reset();
+    }
+    vm->machine.tracer = vm->tracer.get();
+}
+
+int vm_write_trace(vm_t* vm, const char* path) {
+    if (!vm->tracer || !vm->loaded) {
+        vm->error = "Registro desligado ou nenhum programa carregado";
+        return VM_ERROR;
+    }
+    try {
+        vm->tracer->write(path, vm->machine);
+        return VM_OK;
+    } catch (const std::exception& ex) {
+        vm->error = ex.what();
+        return VM_ERROR;
+    }
+}
+
+int vm_seek(vm_t* vm, uint64_t instruction) {
+    if (!vm->tracer || !vm->loaded) {
+        vm->error = "Registro desligado ou nenhum programa carregado";
+        return VM_ERROR;
+    }
+    // a reexecução não pode gravar no próprio registro
+    vm->machine.tracer = nullptr;
+    try {
+        vm->tracer->replay(vm->machine, instruction, nullptr, vm->engine);
+        vm->tracer->truncate(vm->machine.dispatches);
+    } catch (const std::exception& ex) {
+        vm->machine.tracer = vm->tracer.get();
+        vm->error = ex.what();
+        return VM_ERROR;
+    }
+    vm->machine.tracer = vm->tracer.get();
+    vm->error.clear();
+    return VM_OK;
+}
+
+void vm_set_program_cache(size_t bytes) {
+    programCache().setCapacity(bytes);
+}
+
+void vm_program_cache_stats(vm_cache_stats* stats) {
+    ProgramCache::Stats current = programCache().stats();
+    stats->hits = current.hits;
+    stats->misses = current.misses;
+    stats->entries = current.entries;
+    stats->bytes = current.bytes;
+    stats->capacity = current.capacity;
+}
+
+int vm_run_batch(const char* manifest_path, const char* report_path, int threads) {
+    try {
+        std::vector<BatchJob> jobs = readManifest(manifest_path);
+        BatchOptions options;
+        options.threads = threads > 0 ? threads : 0;
+        std::vector<BatchResult> results = runBatch(jobs, options);
+
+        if (report_path) {
+            std::ofstream file(report_path);
+            writeBatchReport(file, jobs, results);
+            if (!file) return -1;
+        } else {
+            writeBatchReport(std::cout, jobs, results);
+        }
+
+        int failed = 0;
+        for (const auto& result : results) {
+            if (!result.ok) failed++;
+        }
+        return failed;
+    } catch (const std::exception&) {
+        return -1;
+    }
+}
+
+vm_t* vm_current(void) {
+    return current;
+}
+
+}
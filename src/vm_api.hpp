@@ -0,0 +1,166 @@
+#ifndef VM_API_HPP
+#define VM_API_HPP
+
+// API C reentrante: cada instância (vm_t) tem só os seus registradores, pilha e programa;
+// a tabela de operações e os programas carregados são imutáveis e compartilhados.
+// Instâncias diferentes podem ser usadas ao mesmo tempo em threads diferentes;
+// uma mesma instância não deve ser usada por duas threads ao mesmo tempo.
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct vm_instance vm_t;
+typedef struct vm_snapshot vm_snapshot_t;
+
+typedef int (*vm_read_fn)(void);
+typedef void (*vm_write_fn)(int);
+typedef void (*vm_flush_fn)(const int* values, size_t count, void* user);
+
+// E/S em buffers (vm_execute_io): RD consome input e PRN escreve em output sem chamar o host
+// a cada valor. input_used e output_size são atualizados pela execução. Com a saída cheia,
+// flush (se houver) recebe os valores e output_size volta a 0.
+typedef struct vm_io {
+    const int* input;
+    size_t input_size;
+    size_t input_used;
+    int* output;
+    size_t output_capacity;
+    size_t output_size;
+    vm_flush_fn flush; // opcional
+    void* user;
+} vm_io;
+
+// Registradores e pilha numa chamada só (vm_get_state). stack aponta direto para a pilha da
+// instância (sem cópia) e vale até a próxima execução ou vm_destroy.
+// [dirty_begin, dirty_end) são as posições da pilha alteradas desde o último vm_get_state
+// (na primeira chamada, a pilha inteira); vazio quando dirty_begin == dirty_end.
+typedef struct vm_state {
+    int ip;
+    int sp;
+    int start_sp;
+    uint64_t instructions; // instruções despachadas (uma superinstrução conta como uma)
+    const int* stack;
+    size_t stack_size;
+    size_t dirty_begin;
+    size_t dirty_end;
+} vm_state;
+
+// Métricas de uma instância desde o último vm_load (vm_get_stats). A altura da pilha é
+// amostrada depois de cada CALL/ALLOC e ao fim de cada execução.
+typedef struct vm_stats {
+    uint64_t instructions;     // instruções executadas (uma superinstrução conta como uma)
+    int64_t call_depth;        // CALLs ainda sem RETURN
+    int64_t max_call_depth;
+    size_t stack_high_water;   // maior número de posições da pilha em uso
+    uint64_t reads;            // RDs concluídos
+    uint64_t writes;           // PRNs concluídos
+    uint64_t io_ns;            // tempo nos callbacks de leitura/escrita (e no flush)
+    uint64_t compute_ns;       // tempo de execução sem a E/S
+} vm_stats;
+
+// Cache de programas do processo (vm_program_cache_stats)
+typedef struct vm_cache_stats {
+    uint64_t hits;
+    uint64_t misses;
+    size_t entries;
+    size_t bytes;    // memória estimada dos programas no cache
+    size_t capacity;
+} vm_cache_stats;
+
+// Códigos de retorno
+#define VM_OK 0
+#define VM_ERROR 1 // mensagem em vm_last_error
+#define VM_NEEDS_INPUT 2 // vm_execute_io: a entrada acabou; chame de novo com mais valores
+#define VM_OUTPUT_FULL 3 // vm_execute_io: a saída encheu (sem flush); esvazie e chame de novo
+#define VM_BUDGET_EXHAUSTED 4 // vm_run: o limite de instruções ou o prazo acabou; chame de novo para continuar
+
+// Motores de execução (vm_set_engine)
+#define VM_ENGINE_TABLE 0
+#define VM_ENGINE_THREADED 1
+#define VM_ENGINE_JIT 2
+
+vm_t* vm_create(void);
+vm_t* vm_create_with_stack(size_t stack_size); // tamanho da pilha em posições (int)
+void vm_destroy(vm_t* vm); // aceita NULL
+
+// Carrega um programa (texto ou binário) e reinicia os registradores. O programa
+// decodificado fica num cache do processo, indexado pelo hash do conteúdo do arquivo:
+// carregar de novo um arquivo que não mudou (em qualquer instância) reaproveita a imagem.
+int vm_load(vm_t* vm, const char* file_path);
+
+// Capacidade do cache de programas em bytes (padrão 64 MiB); os usados há mais tempo saem
+// primeiro. 0 desliga o cache.
+void vm_set_program_cache(size_t bytes);
+void vm_program_cache_stats(vm_cache_stats* stats);
+
+// Retorna VM_ERROR se o motor não existe neste build (o motor atual é mantido)
+int vm_set_engine(vm_t* vm, int engine);
+
+// Executa até HLT, fim do programa ou erro
+int vm_execute(vm_t* vm, vm_read_fn read_fn, vm_write_fn write_fn);
+
+// Executa até HLT, fim do programa, erro ou E/S bloqueada (VM_NEEDS_INPUT/VM_OUTPUT_FULL);
+// a próxima chamada continua de onde parou
+int vm_execute_io(vm_t* vm, vm_io* io);
+
+// Como vm_execute_io, mas executa no máximo max_instructions instruções e, se timeout_us
+// não for 0, para ao passar desse prazo (conferido a cada 65536 instruções). Retorna
+// VM_BUDGET_EXHAUSTED quando um dos limites acaba; a próxima chamada continua exatamente
+// da instrução seguinte. 0 desliga o limite correspondente; io pode ser NULL (sem E/S).
+int vm_run(vm_t* vm, vm_io* io, uint64_t max_instructions, uint64_t timeout_us);
+
+int vm_get_ip(const vm_t* vm);
+int vm_get_sp(const vm_t* vm);
+int vm_get_stack(const vm_t* vm, int index); // 0 fora da pilha
+const int* vm_stack_view(const vm_t* vm, size_t* length); // pilha inteira, sem cópia
+void vm_get_state(vm_t* vm, vm_state* state);
+const char* vm_last_error(const vm_t* vm);   // "" se não houve erro
+void vm_get_stats(const vm_t* vm, vm_stats* stats); // sempre contadas, sem custo para ligar
+
+// Snapshot do estado de uma instância pausada (entre execuções, por exemplo em VM_NEEDS_INPUT):
+// registradores e a parte já tocada da pilha. É imutável: pode ser restaurado várias vezes,
+// em instâncias diferentes e em threads diferentes. NULL em erro (mensagem em vm_last_error).
+vm_snapshot_t* vm_snapshot(vm_t* vm);
+int vm_restore(vm_t* vm, const vm_snapshot_t* snapshot); // a pilha precisa comportar o programa
+void vm_snapshot_destroy(vm_snapshot_t* snapshot); // aceita NULL
+
+// Cria count instâncias no estado atual de vm, com o mesmo motor e tamanho de pilha, em
+// children[0..count-1] (liberadas com vm_destroy). Em erro, nenhuma é criada.
+int vm_fork(vm_t* vm, vm_t** children, size_t count);
+
+// Perfil de execução (ver profiler.hpp): enabled != 0 liga a contagem por opcode, endereço e
+// procedimento nas próximas execuções (com o motor de tabela instrumentado); 0 desliga.
+void vm_set_profiling(vm_t* vm, int enabled);
+
+// Grava o relatório em texto e/ou as pilhas agregadas para flamegraph (caminhos NULL são
+// pulados). Os procedimentos abertos são encerrados antes.
+int vm_write_profile(vm_t* vm, const char* report_path, const char* folded_path);
+
+// Registro da execução (ver trace.hpp): enabled != 0 grava as próximas execuções (com o motor
+// de tabela instrumentado), com checkpoints a cada checkpoint_interval instruções (0: o padrão)
+// e até capacity bytes (0: sem limite; os trechos mais antigos são descartados); 0 desliga.
+void vm_set_tracing(vm_t* vm, int enabled, uint64_t checkpoint_interval, size_t capacity);
+int vm_write_trace(vm_t* vm, const char* path);
+
+// Volta (ou avança) a instância para o estado depois de `instruction` instruções da execução
+// registrada, reexecutando a partir do checkpoint anterior; os PRNs são descartados e o
+// registro posterior também, para que a gravação continue dali (passo para trás no depurador).
+int vm_seek(vm_t* vm, uint64_t instruction);
+
+// Executa os casos de um manifesto (ver batch.hpp) em `threads` workers (0: um por núcleo) e
+// grava o relatório em report_path (NULL: saída padrão). Retorna o número de casos com erro,
+// ou -1 se o manifesto não pôde ser lido ou o relatório gravado.
+int vm_run_batch(const char* manifest_path, const char* report_path, int threads);
+
+// Instância executando na thread atual (para os callbacks de leitura/escrita); NULL fora de vm_execute
+vm_t* vm_current(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // VM_API_HPP
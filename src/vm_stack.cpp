@@ -0,0 +1,225 @@
+#include "vm_stack.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+
+#ifdef VM_HAS_GUARDED_STACK
+
+#include <csetjmp>
+#include <mutex>
+#include <signal.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+// Execução protegida em andamento na thread (encadeadas quando um callback executa outra VM)
+struct GuardFrame {
+    const VMStack* stack;
+    GuardFrame* previous;
+    sigjmp_buf target;
+};
+
+static thread_local GuardFrame* activeFrame = nullptr;
+static struct sigaction previousAction;
+
+// Pilha alternativa para o handler (SA_ONSTACK), uma por thread: sem ela, um SIGSEGV
+// causado pelo esgotamento da pilha nativa não teria onde executar. Threads que já têm uma
+// (instalada pelo host) ficam com a delas.
+struct AltStack {
+    void* memory = nullptr;
+    size_t size = 0;
+
+    AltStack() {
+        stack_t current;
+        if (sigaltstack(nullptr, &current) == 0 && !(current.ss_flags & SS_DISABLE)) {
+            return;
+        }
+        this->size = std::max<size_t>(SIGSTKSZ, 64 << 10);
+        this->memory = mmap(nullptr, this->size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (this->memory == MAP_FAILED) {
+            this->memory = nullptr;
+            return;
+        }
+        stack_t alternate = {};
+        alternate.ss_sp = this->memory;
+        alternate.ss_size = this->size;
+        if (sigaltstack(&alternate, nullptr) != 0) {
+            munmap(this->memory, this->size);
+            this->memory = nullptr;
+        }
+    }
+
+    ~AltStack() {
+        if (!this->memory) return;
+        stack_t disabled = {};
+        disabled.ss_flags = SS_DISABLE;
+        sigaltstack(&disabled, nullptr);
+        munmap(this->memory, this->size);
+    }
+};
+
+static void onSegv(int signal, siginfo_t* info, void* ucontext) {
+    for (GuardFrame* frame = activeFrame; frame; frame = frame->previous) {
+        if (frame->stack->isGuard(info->si_addr)) {
+            siglongjmp(frame->target, 1);
+        }
+    }
+
+    // não é uma página de guarda: repassa para o tratamento anterior
+    if (previousAction.sa_flags & SA_SIGINFO) {
+        previousAction.sa_sigaction(signal, info, ucontext);
+    } else if (previousAction.sa_handler == SIG_DFL) {
+        // restaura o padrão; a instrução falha de novo ao retornar e o processo termina
+        struct sigaction action = {};
+        action.sa_handler = SIG_DFL;
+        sigaction(SIGSEGV, &action, nullptr);
+    } else if (previousAction.sa_handler != SIG_IGN) {
+        previousAction.sa_handler(signal);
+    }
+}
+
+static void installHandler() {
+    static std::once_flag installed;
+    std::call_once(installed, [] {
+        struct sigaction action = {};
+        action.sa_sigaction = onSegv;
+        // SA_NODEFER: o siglongjmp sai do handler sem deixar SIGSEGV bloqueado
+        action.sa_flags = SA_SIGINFO | SA_NODEFER | SA_ONSTACK;
+        sigemptyset(&action.sa_mask);
+        sigaction(SIGSEGV, &action, &previousAction);
+    });
+}
+
+VMStack::VMStack(size_t size) {
+    const size_t page = sysconf(_SC_PAGESIZE);
+    const size_t bytes = std::max<size_t>(page, (size * sizeof(int) + page - 1) / page * page);
+
+    this->guardSize = page;
+    this->regionSize = bytes + 2 * page;
+    this->region = mmap(nullptr, this->regionSize, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (this->region == MAP_FAILED) {
+        this->region = nullptr;
+        throw std::runtime_error("Não foi possível reservar a pilha da VM");
+    }
+
+    char* start = static_cast<char*>(this->region) + page;
+    if (mprotect(start, bytes, PROT_READ | PROT_WRITE) != 0) {
+        munmap(this->region, this->regionSize);
+        this->region = nullptr;
+        throw std::runtime_error("Não foi possível reservar a pilha da VM");
+    }
+
+    this->base = reinterpret_cast<int*>(start);
+    this->length = bytes / sizeof(int);
+    installHandler();
+}
+
+VMStack::~VMStack() {
+    if (this->region) {
+        munmap(this->region, this->regionSize);
+    }
+}
+
+void VMStack::clear(size_t from) {
+    // o começo da página de from é zerado à mão; as páginas seguintes são devolvidas
+    const size_t perPage = this->guardSize / sizeof(int);
+    from = std::min(from, this->length);
+    const size_t next = std::min(this->length, (from + perPage - 1) / perPage * perPage);
+    std::memset(this->base + from, 0, (next - from) * sizeof(int));
+    if (next < this->length) {
+        madvise(this->base + next, (this->length - next) * sizeof(int), MADV_DONTNEED);
+    }
+}
+
+bool VMStack::isGuard(const void* address) const {
+    const uintptr_t a = reinterpret_cast<uintptr_t>(address);
+    const uintptr_t start = reinterpret_cast<uintptr_t>(this->region);
+    const uintptr_t end = start + this->regionSize;
+    const uintptr_t dataStart = reinterpret_cast<uintptr_t>(this->base);
+    const uintptr_t dataEnd = dataStart + this->length * sizeof(int);
+    return (a >= start && a < dataStart) || (a >= dataEnd && a < end);
+}
+
+bool VMStack::runGuarded(void (*run)(void*), void* context) const {
+    static thread_local AltStack altStack;
+    (void)altStack;
+
+    GuardFrame frame;
+    frame.stack = this;
+    frame.previous = activeFrame;
+    activeFrame = &frame;
+
+    if (sigsetjmp(frame.target, 0) != 0) {
+        activeFrame = frame.previous;
+        return false;
+    }
+
+    try {
+        run(context);
+    } catch (...) {
+        activeFrame = frame.previous;
+        throw;
+    }
+    activeFrame = frame.previous;
+    return true;
+}
+
+#else
+
+VMStack::VMStack(size_t size) : fallback(std::max<size_t>(size, 1), 0) {
+    this->base = this->fallback.data();
+    this->length = this->fallback.size();
+}
+
+VMStack::~VMStack() {}
+
+void VMStack::clear(size_t from) {
+    std::fill(this->fallback.begin() + std::min(from, this->length), this->fallback.end(), 0);
+}
+
+bool VMStack::isGuard(const void*) const {
+    return false;
+}
+
+bool VMStack::runGuarded(void (*run)(void*), void* context) const {
+    run(context);
+    return true;
+}
+
+#endif // VM_HAS_GUARDED_STACK
+
+void VMStack::assign(const int* values, size_t count) {
+    count = std::min(count, this->length);
+    this->clear(count);
+    std::memcpy(this->base, values, count * sizeof(int));
+}
+
+void pushFrame(int* stack, size_t size, int& sp, int m, int n) {
+    const int64_t to = int64_t(sp) + 1;
+    if (n > 0 && to >= 0 && to + n <= (int64_t)size && !(m < to && to < int64_t(m) + n)) {
+        std::memmove(stack + to, stack + m, size_t(n) * sizeof(int));
+        sp += n;
+        return;
+    }
+    int top = sp;
+    for (int k = 0; k < n; k++) {
+        top++;
+        stack[top] = stack[m + k];
+    }
+    sp = top;
+}
+
+void popFrame(int* stack, int& sp, int m, int n) {
+    const int64_t from = int64_t(sp) - n + 1;
+    if (n > 0 && from >= 0 && !(m < from && from < int64_t(m) + n)) {
+        std::memmove(stack + m, stack + from, size_t(n) * sizeof(int));
+        sp -= n;
+        return;
+    }
+    int top = sp;
+    for (int k = n - 1; k >= 0; k--) {
+        stack[m + k] = stack[top];
+        top--;
+    }
+    sp = top;
+}
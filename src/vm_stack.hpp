@@ -0,0 +1,80 @@
+#ifndef VM_STACK_HPP
+#define VM_STACK_HPP
+
+#include <cstddef>
+#include <vector>
+
+// Pilha protegida por páginas de guarda (mmap + PROT_NONE) em plataformas POSIX
+#if !defined(_WIN32) && !defined(VM_NO_GUARDED_STACK)
+#define VM_HAS_GUARDED_STACK 1
+#endif
+
+constexpr size_t DEFAULT_STACK_SIZE = 8192;
+
+// Pilha da VM numa região mapeada, com uma página de guarda antes do início e outra depois
+// do fim. As páginas só ocupam memória quando são tocadas pela primeira vez. Um acesso fora
+// da pilha cai numa página de guarda e, dentro de runGuarded, vira um erro da VM em vez de
+// corromper memória: o caminho rápido de push não precisa checar limites.
+// O tamanho é fixo (--stack N): a pilha não cresce, e passar do fim é um erro de execução.
+// Sem mmap, usa um buffer comum (sem proteção).
+class VMStack {
+public:
+    explicit VMStack(size_t size = DEFAULT_STACK_SIZE); // arredondado para páginas inteiras
+    ~VMStack();
+
+    VMStack(const VMStack&) = delete;
+    VMStack& operator=(const VMStack&) = delete;
+
+    int& operator[](ptrdiff_t index) { return base[index]; }
+    const int& operator[](ptrdiff_t index) const { return base[index]; }
+    int* data() { return base; }
+    const int* data() const { return base; }
+    size_t size() const { return length; }
+    int* begin() { return base; }
+    int* end() { return base + length; }
+    const int* begin() const { return base; }
+    const int* end() const { return base + length; }
+
+    // Zera a pilha a partir da posição from, devolvendo as páginas inteiras ao sistema
+    // (voltam zeradas quando tocadas de novo)
+    void clear(size_t from = 0);
+
+    // Copia count valores para o início da pilha e zera o resto
+    void assign(const int* values, size_t count);
+
+    // Executa run(context); retorna false se ele acessou uma página de guarda desta pilha
+    // (a execução é interrompida no ponto do acesso). Exceções de run são repassadas.
+    // A interrupção é um siglongjmp a partir do handler de SIGSEGV, que não executa
+    // destrutores: enquanto acessa a pilha, run não pode manter vivos objetos com destrutor
+    // (como os motores da VM, que só usam ponteiros e inteiros). O handler roda numa pilha
+    // alternativa da thread, instalada aqui na primeira chamada.
+    bool runGuarded(void (*run)(void*), void* context) const;
+
+    // true se o endereço está numa das páginas de guarda
+    bool isGuard(const void* address) const;
+
+private:
+    int* base = nullptr;
+    size_t length = 0;
+    void* region = nullptr; // mapeamento inteiro, com as páginas de guarda
+    size_t regionSize = 0;
+    size_t guardSize = 0;
+    std::vector<int> fallback;
+};
+
+// ALLOC/DALLOC com quadros a partir deste tamanho usam pushFrame/popFrame; abaixo, o laço de
+// cada motor custa menos que a chamada
+constexpr int BULK_FRAME = 16;
+
+// ALLOC m,n: empilha stack[m..m+n-1] a partir de sp + 1 com uma cópia em bloco e atualiza
+// sp. O resultado é o da cópia elemento a elemento: se o destino começa dentro da
+// origem, os valores recém-empilhados são relidos (o padrão se repete) e a cópia segue no
+// laço. Perto das bordas também, para que o primeiro acesso fora da pilha seja o da página
+// de guarda.
+void pushFrame(int* stack, size_t size, int& sp, int m, int n);
+
+// DALLOC m,n: desempilha os n valores do topo para stack[m..m+n-1], do último para o
+// primeiro, e atualiza sp. Em bloco, exceto se a origem começa dentro do destino.
+void popFrame(int* stack, int& sp, int m, int n);
+
+#endif // VM_STACK_HPP
@@ -0,0 +1,362 @@
+#include "vm.hpp"
+#include <stdexcept>
+#include <type_traits>
+
+#ifdef VM_HAS_THREADED_DISPATCH
+
+// Os handlers terminam em sequências iguais ("sp--; despacha"); o GCC as uniria num só
+// salto indireto, e a previsão de desvio por handler é o que faz o despacho threaded valer
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC optimize("no-crossjumping")
+#endif
+
+// Endereço do próximo handler: lido da própria instrução (despacho direto)
+// ou da tabela indexada pelo opcode (imagens mapeadas, executadas sem cópia)
+static inline const void* handlerOf(const ThreadedInstruction* pc, const void* const*) {
+    return pc->handler;
+}
+
+static inline const void* handlerOf(const DecodedInstruction* pc, const void* const* handlers) {
+    return handlers[static_cast<size_t>(pc->opcode)];
+}
+
+void VirtualMachine::executeThreaded() {
+    // o limite de instruções e a falta de valores só são checados nas variantes que precisam
+    const bool budgeted = this->limit != UINT64_MAX;
+    if (this->program->isMapped()) {
+        if (this->checked()) {
+            budgeted ? this->runThreaded<false, true, true>() : this->runThreaded<false, false, true>();
+        } else {
+            budgeted ? this->runThreaded<false, true, false>() : this->runThreaded<false, false, false>();
+        }
+    } else {
+        if (this->checked()) {
+            budgeted ? this->runThreaded<true, true, true>() : this->runThreaded<true, false, true>();
+        } else {
+            budgeted ? this->runThreaded<true, true, false>() : this->runThreaded<true, false, false>();
+        }
+    }
+}
+
+// Motor threaded: todas as operações ficam no mesmo laço, com ip/sp em variáveis locais,
+// e cada instrução salta direto para o handler da seguinte (computed goto).
+// ip/sp só são escritos de volta na VM antes de callbacks, DEBUG, erros e ao final,
+// que são os únicos pontos onde o estado pode ser observado de fora.
+template <bool Direct, bool Budgeted, bool Checked>
+void VirtualMachine::runThreaded() {
+    using Instr = std::conditional_t<Direct, ThreadedInstruction, DecodedInstruction>;
+
+    static const void* const handlers[OPCODE_COUNT] = {
+        &&op_NOP, &&op_NOP, &&op_HLT, &&op_DEBUG, &&op_LDC, &&op_LDV,
+        &&op_ADD, &&op_SUB, &&op_MULT, &&op_DIVI, &&op_INV, &&op_AND,
+        &&op_OR, &&op_NEG, &&op_CME, &&op_CMA, &&op_CEQ, &&op_CDIF,
+        &&op_CMEQ, &&op_CMAQ, &&op_JMP, &&op_JMPF, &&op_ALLOC, &&op_DALLOC,
+        &&op_RD, &&op_PRN, &&op_STR, &&op_CALL, &&op_RETURN, &&op_END,
+        &&op_LDV_LDV_ADD_STR, &&op_LDV_LDV_SUB_STR, &&op_LDV_LDV_MULT_STR,
+        &&op_LDV_LDC_CME_JMPF, &&op_LDV_LDC_CMA_JMPF, &&op_LDV_LDC_CEQ_JMPF,
+        &&op_LDV_LDC_CDIF_JMPF, &&op_LDV_LDC_CMEQ_JMPF, &&op_LDV_LDC_CMAQ_JMPF,
+        &&op_LDV_PRN, &&op_CALL_ALLOC, &&op_DALLOC_RETURN,
+    };
+
+    const Instr* base;
+    if constexpr (Direct) {
+        base = this->program->threaded(handlers);
+    } else {
+        base = this->program->code();
+    }
+
+    const unsigned size = this->program->size();
+    int* const stack = this->stack.data();
+    const size_t stackSize = this->stack.size();
+    const int start_sp = this->start_sp;
+
+    if ((unsigned)this->ip >= size) {
+        return;
+    }
+
+    const Instr* pc = base + this->ip;
+    int sp = this->sp;
+    uint64_t dispatches = this->dispatches;
+    const uint64_t limit = this->limit;
+
+// ip da VM aponta para a instrução seguinte enquanto a atual executa (como no motor de tabela)
+#define SYNC() (this->ip = (int)(pc - base) + 1, this->sp = sp, this->dispatches = dispatches)
+// limite de instruções atingido: para antes da instrução em pc (só na variante Budgeted)
+#define BUDGET_EXHAUSTED() do { \
+        this->sp = sp; \
+        this->dispatches = dispatches; \
+        this->status = ExecStatus::BudgetExhausted; \
+        this->suspend((int)(pc - base)); \
+        return; \
+    } while (0)
+#define DISPATCH() do { \
+        if constexpr (Budgeted) { if (dispatches >= limit) BUDGET_EXHAUSTED(); } \
+        dispatches++; \
+        goto *handlerOf(pc, handlers); \
+    } while (0)
+#define NEXT() do { ++pc; DISPATCH(); } while (0)
+#define JUMP(target) do { pc = base + (target); DISPATCH(); } while (0)
+// quadros grandes em bloco (vm_stack.hpp), os demais valor a valor
+#define ALLOC_FRAME(m, n) do { \
+        const int m_ = (m), n_ = (n); \
+        if (n_ >= BULK_FRAME) { int top = sp; pushFrame(stack, stackSize, top, m_, n_); sp = top; break; } \
+        for (int k = 0; k < n_; k++) { sp++; stack[sp] = stack[m_ + k]; } \
+    } while (0)
+#define DALLOC_FRAME(m, n) do { \
+        const int m_ = (m), n_ = (n); \
+        if (n_ >= BULK_FRAME) { int top = sp; popFrame(stack, top, m_, n_); sp = top; break; } \
+        for (int k = n_ - 1; k >= 0; k--) { stack[m_ + k] = stack[sp]; sp--; } \
+    } while (0)
+#define FAIL(msg) do { SYNC(); throw std::runtime_error(msg); } while (0)
+#define BINARY(name, expr) \
+    if (Checked && sp <= start_sp + 1) FAIL("Valores insuficientes na stack " name); \
+    stack[sp - 1] = (expr); \
+    sp--; \
+    NEXT()
+// Superinstruções (ver ops.cpp): mesmas escritas na pilha que a sequência original;
+// sem valores suficientes, executa só o LDV e segue pelas instruções originais
+#define FUSED_ARITH(op) \
+    if (Checked && sp < start_sp) goto op_LDV; \
+    stack[sp + 1] = stack[pc->op1]; \
+    stack[sp + 2] = stack[pc[1].op1]; \
+    stack[sp + 1] = stack[sp + 1] op stack[sp + 2]; \
+    stack[pc[3].op1] = stack[sp + 1]; \
+    pc += 4; \
+    DISPATCH()
+#define FUSED_COMPARE_JUMP(cmp) \
+    if (Checked && sp < start_sp) goto op_LDV; \
+    stack[sp + 1] = stack[pc->op1]; \
+    stack[sp + 2] = pc[1].op1; \
+    stack[sp + 1] = (stack[sp + 1] cmp stack[sp + 2]) ? 1 : 0; \
+    if (stack[sp + 1] == 0) JUMP(pc[3].op1); \
+    pc += 4; \
+    DISPATCH()
+
+    DISPATCH();
+
+op_NOP:
+    NEXT();
+
+op_DEBUG:
+    SYNC();
+    this->debug();
+    NEXT();
+
+op_LDC:
+    sp++;
+    stack[sp] = pc->op1;
+    NEXT();
+
+op_LDV:
+    sp++;
+    stack[sp] = stack[pc->op1];
+    NEXT();
+
+op_ADD:
+    BINARY("ADD", stack[sp - 1] + stack[sp]);
+
+op_SUB:
+    BINARY("SUB", stack[sp - 1] - stack[sp]);
+
+op_MULT:
+    BINARY("MULT", stack[sp - 1] * stack[sp]);
+
+op_DIVI:
+    if (Checked && sp <= start_sp + 1) FAIL("Valores insuficientes na stack DIVI");
+    if (stack[sp] == 0) FAIL("Divisao por 0");
+    stack[sp - 1] /= stack[sp];
+    sp--;
+    NEXT();
+
+op_INV:
+    stack[sp] = -stack[sp];
+    NEXT();
+
+op_AND:
+    BINARY("AND", (stack[sp - 1] == 1 && stack[sp] == 1) ? 1 : 0);
+
+op_OR:
+    BINARY("OR", (stack[sp - 1] == 1 || stack[sp] == 1) ? 1 : 0);
+
+op_NEG:
+    stack[sp] = 1 - stack[sp];
+    NEXT();
+
+op_CME:
+    BINARY("CME", (stack[sp - 1] < stack[sp]) ? 1 : 0);
+
+op_CMA:
+    BINARY("CMA", (stack[sp - 1] > stack[sp]) ? 1 : 0);
+
+op_CEQ:
+    BINARY("CEQ", (stack[sp - 1] == stack[sp]) ? 1 : 0);
+
+op_CDIF:
+    BINARY("CDIF", (stack[sp - 1] != stack[sp]) ? 1 : 0);
+
+op_CMEQ:
+    BINARY("CMEQ", (stack[sp - 1] <= stack[sp]) ? 1 : 0);
+
+op_CMAQ:
+    BINARY("CMAQ", (stack[sp - 1] >= stack[sp]) ? 1 : 0);
+
+op_JMP:
+    JUMP(pc->op1);
+
+op_JMPF:
+    if (Checked && sp <= start_sp) FAIL("Stack esta vazia para o JMPF");
+    if (stack[sp--] == 0) {
+        JUMP(pc->op1);
+    }
+    NEXT();
+
+op_ALLOC:
+    ALLOC_FRAME(pc->op1, pc->op2);
+    this->stats.frameTop(sp);
+    NEXT();
+
+op_DALLOC:
+    DALLOC_FRAME(pc->op1, pc->op2);
+    NEXT();
+
+op_RD: {
+    SYNC();
+    const int var = this->readFn();
+    if (this->status != ExecStatus::Running) {
+        this->dispatches--;
+        this->suspend((int)(pc - base));
+        return;
+    }
+    sp++;
+    stack[sp] = var;
+    NEXT();
+}
+
+op_PRN:
+    SYNC();
+    this->writeFn(stack[sp]);
+    if (this->status != ExecStatus::Running) {
+        this->dispatches--;
+        this->suspend((int)(pc - base));
+        return;
+    }
+    sp--;
+    NEXT();
+
+op_STR:
+    stack[pc->op1] = stack[sp];
+    sp--;
+    NEXT();
+
+op_CALL:
+    sp++;
+    stack[sp] = (int)(pc - base) + 1;
+    this->stats.enterCall();
+    this->stats.frameTop(sp);
+    JUMP(pc->op1);
+
+op_CALL_ALLOC: {
+    // o ALLOC do procedimento executa aqui e a execução segue na instrução depois dele
+    const Instr* alloc = base + pc->op1;
+    sp++;
+    stack[sp] = (int)(pc - base) + 1;
+    ALLOC_FRAME(alloc->op1, alloc->op2);
+    this->stats.enterCall();
+    this->stats.frameTop(sp);
+    pc = alloc;
+    NEXT();
+}
+
+op_DALLOC_RETURN:
+    DALLOC_FRAME(pc->op1, pc->op2);
+    goto op_RETURN;
+
+op_RETURN: {
+    const int target = stack[sp];
+    sp--;
+    this->stats.callDepth--;
+    if ((unsigned)target >= size) {
+        this->ip = target;
+        this->sp = sp;
+        this->dispatches = dispatches;
+        return;
+    }
+    JUMP(target);
+}
+
+op_LDV_LDV_ADD_STR:
+    FUSED_ARITH(+);
+
+op_LDV_LDV_SUB_STR:
+    FUSED_ARITH(-);
+
+op_LDV_LDV_MULT_STR:
+    FUSED_ARITH(*);
+
+op_LDV_LDC_CME_JMPF:
+    FUSED_COMPARE_JUMP(<);
+
+op_LDV_LDC_CMA_JMPF:
+    FUSED_COMPARE_JUMP(>);
+
+op_LDV_LDC_CEQ_JMPF:
+    FUSED_COMPARE_JUMP(==);
+
+op_LDV_LDC_CDIF_JMPF:
+    FUSED_COMPARE_JUMP(!=);
+
+op_LDV_LDC_CMEQ_JMPF:
+    FUSED_COMPARE_JUMP(<=);
+
+op_LDV_LDC_CMAQ_JMPF:
+    FUSED_COMPARE_JUMP(>=);
+
+op_LDV_PRN:
+    // durante o writeFn, ip/sp são os que o PRN original veria
+    sp++;
+    stack[sp] = stack[pc->op1];
+    pc++;
+    SYNC();
+    this->writeFn(stack[sp]);
+    if (this->status != ExecStatus::Running) {
+        this->dispatches--; // o PRN refeito conta a sequência
+        this->suspend((int)(pc - base));
+        return;
+    }
+    sp--;
+    NEXT();
+
+op_HLT:
+    SYNC();
+    return;
+
+op_END:
+    // o END não é uma instrução do programa
+    this->ip = (int)(pc - base);
+    this->sp = sp;
+    this->dispatches = dispatches - 1;
+    return;
+
+#undef FUSED_COMPARE_JUMP
+#undef FUSED_ARITH
+#undef BINARY
+#undef FAIL
+#undef DALLOC_FRAME
+#undef ALLOC_FRAME
+#undef JUMP
+#undef NEXT
+#undef DISPATCH
+#undef BUDGET_EXHAUSTED
+#undef SYNC
+}
+
+template void VirtualMachine::runThreaded<true, false, true>();
+template void VirtualMachine::runThreaded<true, true, true>();
+template void VirtualMachine::runThreaded<false, false, true>();
+template void VirtualMachine::runThreaded<false, true, true>();
+template void VirtualMachine::runThreaded<true, false, false>();
+template void VirtualMachine::runThreaded<true, true, false>();
+template void VirtualMachine::runThreaded<false, false, false>();
+template void VirtualMachine::runThreaded<false, true, false>();
+
+#endif // VM_HAS_THREADED_DISPATCH